@@ -0,0 +1,251 @@
+#pragma once
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <type_traits>
+
+#include "common.hpp"
+
+// -----------------------------------------------------------
+// Deferred-format debug log
+//
+// The app never formats a debug line. It appends a message id and the raw
+// arguments to a fixed per-process buffer, which travels to the companion
+// behind the launch report; the companion looks the format up in the same
+// table and writes the line to logcat. Release builds compile BLOGD away
+// together with its arguments.
+// -----------------------------------------------------------
+#define COPG_LOG_MESSAGES(X) \
+    X(MSG_MODULE_LOADED, "onLoad => module loaded successfully!") \
+    X(MSG_NOT_APPLICATION, "preAppSpecialize => uid %d is not an application => closing module") \
+    X(MSG_PRE_APP, "preAppSpecialize => uid = %d (user %u, app %u)") \
+    X(MSG_NOT_TARGETED, "uid %d not targeted => closing module") \
+    X(MSG_SPOOFED_UNLOADING, "preAppSpecialize => Build fields applied, unloading module after post for uid: %d") \
+    X(MSG_KEEPING_ACTIVE, "preAppSpecialize => keeping module active for uid: %d") \
+    X(MSG_SERVER_CLOSING, "preServerSpecialize => Closing module for system server") \
+    X(MSG_BUILTIN_MATCHED, "Built-in profile for %s: model %s") \
+    X(MSG_CONFIG_RECEIVED, "Device configuration received: brand %s, model %s, device %s, manufacturer %s, product %s") \
+    X(MSG_SPOOFING_BEGIN, "Beginning spoofing operations") \
+    X(MSG_BUILD_FIELDS_DONE, "Build field spoofing completed successfully") \
+    X(MSG_SPOOFING_DONE, "All spoofing operations completed") \
+    X(MSG_BUILD_FIELDS_UPDATING, "Updating Build fields with device configuration") \
+    X(MSG_BUILD_FIELDS_UPDATED, "Build field updates completed") \
+    X(MSG_FIELD_SKIPPED, "Skipping empty field: %s") \
+    X(MSG_FIELD_NOT_FOUND, "Field '%s' not found in Build or VERSION classes") \
+    X(MSG_FIELD_SET, "Successfully set Java field '%s' = '%s'") \
+    X(MSG_PROPERTIES_BEGIN, "Applying %u properties for: %s") \
+    X(MSG_PROPERTY_SET, "Successfully set property '%s' = '%s'") \
+    X(MSG_PROPERTIES_DONE, "Property spoofing completed successfully") \
+    X(MSG_SOC_FILES_READY, "Serving %u synthesized SoC files") \
+    X(MSG_GL_STRINGS_READY, "Serving GL strings: renderer %s, vendor %s") \
+    X(MSG_HOOKS_INSTALLED, "Installed PLT hooks in %u libraries")
+
+enum LogMessage : uint16_t {
+#define COPG_LOG_MESSAGE_ID(id, format) id,
+    COPG_LOG_MESSAGES(COPG_LOG_MESSAGE_ID)
+#undef COPG_LOG_MESSAGE_ID
+    MSG_COUNT,
+};
+
+static constexpr const char *LOG_FORMATS[MSG_COUNT] = {
+#define COPG_LOG_MESSAGE_FORMAT(id, format) format,
+    COPG_LOG_MESSAGES(COPG_LOG_MESSAGE_FORMAT)
+#undef COPG_LOG_MESSAGE_FORMAT
+};
+
+class BinaryLog {
+public:
+    static constexpr uint32_t CAPACITY = 8192;
+
+    // Record: uint16 id, uint8 argument count, then per argument a tag byte
+    // and either 8 raw bytes or a length byte and the string bytes
+    enum ArgTag : uint8_t {
+        ARG_INT,
+        ARG_UINT,
+        ARG_DOUBLE,
+        ARG_STRING,
+    };
+
+    // Safe from any thread: space is reserved with a single fetch_add, and
+    // a record that does not fit is counted and dropped
+    template <class... Args>
+    void append(LogMessage id, Args... args) {
+        uint32_t size = 3 + (argSize(args) + ... + 0);
+        uint32_t offset = used.fetch_add(size, std::memory_order_relaxed);
+        if (offset + size > CAPACITY) {
+            // Reservations are ordered, so the first failing offset is where
+            // the last record that fit ends
+            uint32_t end = validEnd.load(std::memory_order_relaxed);
+            while (offset < end && !validEnd.compare_exchange_weak(end, offset, std::memory_order_relaxed)) {}
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        uint8_t *out = buffer + offset;
+        memcpy(out, &id, sizeof(id));
+        out[2] = static_cast<uint8_t>(sizeof...(args));
+        out += 3;
+        ((out = put(out, args)), ...);
+    }
+
+    const uint8_t *data() const { return buffer; }
+    uint32_t size() const {
+        uint32_t n = used.load(std::memory_order_relaxed);
+        return n <= CAPACITY ? n : validEnd.load(std::memory_order_relaxed);
+    }
+    uint32_t droppedCount() const { return dropped.load(std::memory_order_relaxed); }
+
+    void reset() {
+        used.store(0, std::memory_order_relaxed);
+        validEnd.store(CAPACITY, std::memory_order_relaxed);
+        dropped.store(0, std::memory_order_relaxed);
+    }
+
+    // Formats every record of data and hands each line to fn; stops at the
+    // first malformed record
+    template <class Fn>
+    static void forEachLine(const uint8_t *data, uint32_t size, Fn &&fn) {
+        const uint8_t *cursor = data;
+        const uint8_t *end = data + size;
+        char line[512];
+        while (end - cursor >= 3) {
+            uint16_t id;
+            memcpy(&id, cursor, sizeof(id));
+            uint8_t argCount = cursor[2];
+            cursor += 3;
+            if (id >= MSG_COUNT || !format(LOG_FORMATS[id], argCount, cursor, end, line, sizeof(line))) return;
+            fn(line);
+        }
+    }
+
+private:
+    uint8_t buffer[CAPACITY];
+    std::atomic<uint32_t> used{0};
+    std::atomic<uint32_t> validEnd{CAPACITY};
+    std::atomic<uint32_t> dropped{0};
+
+    template <class T>
+    static uint32_t argSize(T value) {
+        if constexpr (std::is_same_v<T, const char *> || std::is_same_v<T, char *>) {
+            size_t length = value ? strlen(value) : 0;
+            return 2 + static_cast<uint32_t>(length > 255 ? 255 : length);
+        } else {
+            return 1 + 8;
+        }
+    }
+
+    template <class T>
+    static uint8_t *put(uint8_t *out, T value) {
+        if constexpr (std::is_same_v<T, const char *> || std::is_same_v<T, char *>) {
+            size_t length = value ? strlen(value) : 0;
+            if (length > 255) length = 255;
+            out[0] = ARG_STRING;
+            out[1] = static_cast<uint8_t>(length);
+            if (length) memcpy(out + 2, value, length);
+            return out + 2 + length;
+        } else if constexpr (std::is_floating_point_v<T>) {
+            double raw = value;
+            out[0] = ARG_DOUBLE;
+            memcpy(out + 1, &raw, 8);
+            return out + 9;
+        } else if constexpr (std::is_signed_v<T>) {
+            int64_t raw = value;
+            out[0] = ARG_INT;
+            memcpy(out + 1, &raw, 8);
+            return out + 9;
+        } else {
+            static_assert(std::is_integral_v<T> || std::is_enum_v<T>, "unsupported log argument");
+            uint64_t raw = static_cast<uint64_t>(value);
+            out[0] = ARG_UINT;
+            memcpy(out + 1, &raw, 8);
+            return out + 9;
+        }
+    }
+
+    // printf over the recorded arguments: each conversion is rebuilt with
+    // the argument's recorded width, so %d of an int32 reads an int64
+    static bool format(const char *fmt, uint8_t argCount, const uint8_t *&cursor, const uint8_t *end,
+                       char *out, size_t outSize) {
+        size_t length = 0;
+        auto emit = [&](int written) {
+            if (written > 0) length += static_cast<size_t>(written);
+            if (length >= outSize) length = outSize - 1;
+        };
+        out[0] = '\0';
+
+        for (const char *f = fmt; *f;) {
+            if (*f != '%' || f[1] == '%') {
+                if (length + 1 < outSize) out[length++] = *f;
+                f += *f == '%' ? 2 : 1;
+                out[length] = '\0';
+                continue;
+            }
+
+            // %[flags][width][.precision][length]conversion, length dropped
+            char spec[32] = "%";
+            size_t specLength = 1;
+            for (f++; *f && strchr("-+ #0123456789.", *f) && specLength < 24; f++) spec[specLength++] = *f;
+            while (*f && strchr("hlLqjzt", *f)) f++;
+            char conversion = *f ? *f++ : '\0';
+
+            if (argCount == 0 || end - cursor < 1) return false;
+            argCount--;
+            uint8_t tag = *cursor++;
+            if (tag == ARG_STRING) {
+                if (end - cursor < 1 || end - cursor - 1 < cursor[0]) return false;
+                char text[256];
+                uint8_t textLength = cursor[0];
+                memcpy(text, cursor + 1, textLength);
+                text[textLength] = '\0';
+                cursor += 1 + textLength;
+                spec[specLength++] = 's';
+                spec[specLength] = '\0';
+                emit(snprintf(out + length, outSize - length, spec, conversion == 's' ? text : "<?>"));
+                continue;
+            }
+
+            if (end - cursor < 8) return false;
+            uint64_t raw;
+            memcpy(&raw, cursor, 8);
+            cursor += 8;
+            if (tag == ARG_DOUBLE) {
+                double value;
+                memcpy(&value, &raw, 8);
+                spec[specLength++] = strchr("eEfFgGaA", conversion) ? conversion : 'g';
+                spec[specLength] = '\0';
+                emit(snprintf(out + length, outSize - length, spec, value));
+            } else if (conversion == 'c') {
+                spec[specLength++] = 'c';
+                spec[specLength] = '\0';
+                emit(snprintf(out + length, outSize - length, spec, static_cast<int>(raw)));
+            } else {
+                bool isSigned = tag == ARG_INT && (conversion == 'd' || conversion == 'i');
+                spec[specLength++] = 'l';
+                spec[specLength++] = 'l';
+                spec[specLength++] = strchr("diouxX", conversion) ? conversion : (isSigned ? 'd' : 'u');
+                spec[specLength] = '\0';
+                if (isSigned) {
+                    emit(snprintf(out + length, outSize - length, spec, static_cast<long long>(raw)));
+                } else {
+                    emit(snprintf(out + length, outSize - length, spec, static_cast<unsigned long long>(raw)));
+                }
+            }
+        }
+
+        // Arguments the format did not consume are skipped
+        while (argCount--) {
+            if (end - cursor < 1) return false;
+            uint8_t tag = *cursor++;
+            size_t skip = tag == ARG_STRING ? (end - cursor >= 1 ? 1 + cursor[0] : SIZE_MAX) : 8;
+            if (static_cast<size_t>(end - cursor) < skip) return false;
+            cursor += skip;
+        }
+        return true;
+    }
+};
+
+#if COPG_LOG_LEVEL >= COPG_LOG_LEVEL_DEBUG
+#define BLOGD(log, ...) (log).append(__VA_ARGS__)
+#else
+#define BLOGD(...) ((void) 0)
+#endif
@@ -0,0 +1,148 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include "profile.hpp"
+
+// -----------------------------------------------------------
+// Built-in profiles
+//
+// cmake/builtin_config.cmake turns the shipped config.json into
+// builtin_config.hpp at build time: one record per group and the packages
+// bound to it. While BUILTIN_CONFIG_PROPERTY reads "builtin" the app looks
+// its package up here instead of asking the companion, so the targeting
+// decision takes no file access, no IPC and no parsing.
+//
+// post-fs-data.sh sets the property when there is no user configuration;
+// a user configuration added later takes effect after a reboot.
+//
+// A group with BY_SDK entries gets one record per level they name, in
+// ascending order after the record for levels below all of them; the app
+// reads ro.build.version.sdk only when its package has such records.
+// -----------------------------------------------------------
+#define BUILTIN_CONFIG_PROPERTY "copg.config"
+#define BUILTIN_CONFIG_VALUE "builtin"
+
+struct BuiltinProfile {
+    uint32_t minSdk;    // Lowest SDK level the record applies to
+    uint32_t variants;  // Records of the group, this one included; set on its first only
+    const char *fields[PROFILE_FIELD_COUNT];  // Empty string if unset
+};
+
+struct BuiltinPackage {
+    const char *name;
+    uint32_t profile;  // First record of its group in BUILTIN_PROFILES
+};
+
+// Only reached while an index is built, where it stops compilation
+inline void packageIndexFoundNoSeed() {}
+
+// Perfect hash over a fixed set of package names, built at compile time by
+// hash and displace: a first hash picks a bucket, and every bucket gets the
+// smallest seed that sends all of its names to free slots. A lookup is two
+// hashes, one probe and one strcmp.
+template <size_t N>
+class PackageIndex {
+public:
+    static_assert(N < UINT16_MAX, "slots hold 16-bit package indices");
+
+    constexpr explicit PackageIndex(const std::array<BuiltinPackage, N> &packages) {
+        // Package indices grouped by bucket, bucket b at [first[b], first[b + 1])
+        std::array<uint32_t, SLOTS + 1> first{};
+        std::array<uint32_t, N ? N : 1> members{};
+        for (const auto &package : packages) first[bucketOf(package.name) + 1]++;
+        uint32_t largest = 0;
+        for (size_t bucket = 0; bucket < SLOTS; bucket++) {
+            if (first[bucket + 1] > largest) largest = first[bucket + 1];
+            first[bucket + 1] += first[bucket];
+        }
+        std::array<uint32_t, SLOTS> filled{};
+        for (uint32_t i = 0; i < N; i++) {
+            uint32_t bucket = bucketOf(packages[i].name);
+            members[first[bucket] + filled[bucket]++] = i;
+        }
+
+        // Largest buckets first, while most slots are still free
+        for (uint32_t size = largest; size > 0; size--) {
+            for (uint32_t bucket = 0; bucket < SLOTS; bucket++) {
+                if (first[bucket + 1] - first[bucket] != size) continue;
+                place(bucket, &members[first[bucket]], size, packages);
+            }
+        }
+    }
+
+    const BuiltinPackage *find(const char *name, const std::array<BuiltinPackage, N> &packages) const {
+        uint16_t seed = seeds[bucketOf(name)];
+        if (!seed) return nullptr;
+        uint16_t slot = slots[hash(name, seed) & (SLOTS - 1)];
+        if (!slot || strcmp(packages[slot - 1].name, name) != 0) return nullptr;
+        return &packages[slot - 1];
+    }
+
+private:
+    static constexpr size_t SLOTS = [] {
+        size_t slots = 2;
+        while (slots < 2 * N) slots <<= 1;
+        return slots;
+    }();
+
+    std::array<uint16_t, SLOTS> seeds{};  // Per bucket, 0 if empty
+    std::array<uint16_t, SLOTS> slots{};  // Package index + 1, 0 if free
+
+    static constexpr uint32_t hash(const char *name, uint32_t seed) {
+        uint32_t h = 2166136261u ^ (seed * 0x9e3779b9u);
+        for (; *name; name++) h = (h ^ static_cast<uint8_t>(*name)) * 16777619u;
+        h ^= h >> 16;
+        h *= 0x85ebca6bu;
+        return h ^ (h >> 13);
+    }
+
+    static constexpr uint32_t bucketOf(const char *name) { return hash(name, 0) & (SLOTS - 1); }
+
+    constexpr void place(uint32_t bucket, const uint32_t *members, uint32_t count,
+                         const std::array<BuiltinPackage, N> &packages) {
+        for (uint32_t seed = 1; seed < UINT16_MAX; seed++) {
+            uint32_t placed = 0;
+            while (placed < count) {
+                uint16_t &slot = slots[hash(packages[members[placed]].name, seed) & (SLOTS - 1)];
+                if (slot) break;
+                slot = static_cast<uint16_t>(members[placed] + 1);
+                placed++;
+            }
+            if (placed == count) {
+                seeds[bucket] = static_cast<uint16_t>(seed);
+                return;
+            }
+            // Undo this attempt; the slots it took were free before
+            while (placed--) slots[hash(packages[members[placed]].name, seed) & (SLOTS - 1)] = 0;
+        }
+        // Duplicate names never separate
+        packageIndexFoundNoSeed();
+    }
+};
+
+#ifdef COPG_BUILTIN_CONFIG
+#include "builtin_config.hpp"
+
+static constexpr PackageIndex<BUILTIN_PACKAGES.size()> BUILTIN_INDEX{BUILTIN_PACKAGES};
+
+// Profile built in for the package whose main process is named process, the
+// record for the running level if there are several; only then is
+// sdkLevel() called
+template <class SdkLevel>
+static inline const BuiltinProfile *findBuiltinProfile(const char *process, SdkLevel sdkLevel) {
+    const BuiltinPackage *package = BUILTIN_INDEX.find(process, BUILTIN_PACKAGES);
+    if (!package) return nullptr;
+
+    const BuiltinProfile *first = &BUILTIN_PROFILES[package->profile];
+    const BuiltinProfile *selected = first;
+    if (first->variants > 1) {
+        uint32_t level = sdkLevel();
+        for (uint32_t i = 1; i < first->variants && first[i].minSdk <= level; i++) selected = &first[i];
+    }
+    return selected;
+}
+#endif
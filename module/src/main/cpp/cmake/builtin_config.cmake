@@ -0,0 +1,204 @@
+# Built-in profiles for builtin.hpp, generated from a config.json
+#
+#   cmake -DINPUT=<config.json> -DOUTPUT=<builtin_config.hpp> -P builtin_config.cmake
+#
+# Follows the companion's rules for what it supports: groups are visited in
+# key order, the first group listing a package wins, "extends" chains are
+# flattened and over-long values are dropped. BY_SDK entries along a chain
+# give the group one record per level they name, the app picks one at
+# launch. Packages qualified with "@<userId>", PROPS, SOC, _PROCESSES and
+# _OVERRIDES need the companion and are left out with a warning.
+
+cmake_minimum_required(VERSION 3.22.1)
+
+if (NOT INPUT OR NOT OUTPUT)
+    message(FATAL_ERROR "usage: cmake -DINPUT=... -DOUTPUT=... -P builtin_config.cmake")
+endif ()
+
+# DeviceConfig::forEachField order, as PROFILE_KEYS
+set(FIELDS BRAND DEVICE MANUFACTURER MODEL FINGERPRINT PRODUCT BOARD HARDWARE SERIAL GL_RENDERER GL_VENDOR)
+# PROP_VALUE_MAX, NUL included
+set(VALUE_MAX 92)
+
+file(READ ${INPUT} config)
+
+# Levels of the BY_SDK entries of profile the companion accepts
+function(sdk_entries profile out)
+    set(levels "")
+    string(JSON count ERROR_VARIABLE missing LENGTH "${config}" ${profile} BY_SDK)
+    if (NOT missing AND count GREATER 0)
+        math(EXPR last "${count} - 1")
+        foreach (index RANGE ${last})
+            string(JSON level MEMBER "${config}" ${profile} BY_SDK ${index})
+            string(JSON type TYPE "${config}" ${profile} BY_SDK ${level})
+            string(JSON unused ERROR_VARIABLE flat TYPE "${config}" ${profile} BY_SDK ${level} BY_SDK)
+            if (level MATCHES "^[0-9]+$" AND type STREQUAL "OBJECT" AND flat)
+                list(APPEND levels ${level})
+            endif ()
+        endforeach ()
+    endif ()
+    set(${out} "${levels}" PARENT_SCOPE)
+endfunction()
+
+# Levels named by BY_SDK entries along the chain of profile, ascending,
+# after 0 for the levels below all of them
+function(chain_sdk_levels profile out)
+    set(levels 0)
+    foreach (depth RANGE 16)
+        sdk_entries(${profile} entries)
+        list(APPEND levels ${entries})
+        string(JSON base ERROR_VARIABLE missing GET "${config}" ${profile} extends)
+        if (missing)
+            break()
+        endif ()
+        set(profile ${base})
+    endforeach ()
+    list(TRANSFORM levels REPLACE "^0+([0-9])" "\\1")
+    list(REMOVE_DUPLICATES levels)
+    list(SORT levels COMPARE NATURAL)
+    set(${out} "${levels}" PARENT_SCOPE)
+endfunction()
+
+# Value of field at sdk in profile or the first base that sets it, each
+# profile's selected BY_SDK entry over its own fields; "" if none
+function(resolve_field profile field sdk out)
+    set(value "")
+    foreach (depth RANGE 16)
+        sdk_entries(${profile} entries)
+        set(selected "")
+        foreach (level IN LISTS entries)
+            if (NOT level GREATER sdk AND (selected STREQUAL "" OR level GREATER selected))
+                set(selected ${level})
+            endif ()
+        endforeach ()
+        if (NOT selected STREQUAL "")
+            string(JSON type ERROR_VARIABLE missing TYPE "${config}" ${profile} BY_SDK ${selected} ${field})
+            if (NOT missing AND type STREQUAL "STRING")
+                string(JSON value GET "${config}" ${profile} BY_SDK ${selected} ${field})
+                break()
+            endif ()
+        endif ()
+        string(JSON type ERROR_VARIABLE missing TYPE "${config}" ${profile} ${field})
+        if (NOT missing AND type STREQUAL "STRING")
+            string(JSON value GET "${config}" ${profile} ${field})
+            break()
+        endif ()
+        string(JSON base ERROR_VARIABLE missing GET "${config}" ${profile} extends)
+        if (missing)
+            break()
+        endif ()
+        set(profile ${base})
+    endforeach ()
+
+    string(LENGTH "${value}" length)
+    if (NOT length LESS VALUE_MAX)
+        message(WARNING "${INPUT}: ${field} of ${profile} exceeds ${VALUE_MAX} bytes, ignoring")
+        set(value "")
+    endif ()
+    string(REPLACE "\\" "\\\\" value "${value}")
+    string(REPLACE "\"" "\\\"" value "${value}")
+    set(${out} "\"${value}\"" PARENT_SCOPE)
+endfunction()
+
+set(profiles "")
+set(packages "")
+set(profileCount 0)
+set(packageCount 0)
+set(seen "")
+
+string(JSON memberCount LENGTH "${config}")
+math(EXPR lastMember "${memberCount} - 1")
+foreach (index RANGE ${lastMember})
+    string(JSON group MEMBER "${config}" ${index})
+    string(JSON type TYPE "${config}" ${group})
+    if (NOT group MATCHES "^PACKAGES_" OR NOT type STREQUAL "ARRAY")
+        continue()
+    endif ()
+
+    string(JSON deviceType ERROR_VARIABLE missing TYPE "${config}" ${group}_DEVICE)
+    if (missing OR NOT deviceType STREQUAL "OBJECT")
+        message(WARNING "${INPUT}: ${group}_DEVICE not found")
+        continue()
+    endif ()
+    foreach (companionOnly ${group}_PROCESSES ${group}_OVERRIDES)
+        string(JSON unused ERROR_VARIABLE missing TYPE "${config}" ${companionOnly})
+        if (NOT missing)
+            message(WARNING "${INPUT}: ${companionOnly} is not built in")
+        endif ()
+    endforeach ()
+    sdk_entries(${group}_DEVICE entries)
+    foreach (companionOnly PROPS SOC)
+        string(JSON unused ERROR_VARIABLE missing TYPE "${config}" ${group}_DEVICE ${companionOnly})
+        if (NOT missing)
+            message(WARNING "${INPUT}: ${companionOnly} of ${group}_DEVICE is not built in")
+        endif ()
+        foreach (level IN LISTS entries)
+            string(JSON unused ERROR_VARIABLE missing TYPE "${config}" ${group}_DEVICE BY_SDK ${level} ${companionOnly})
+            if (NOT missing)
+                message(WARNING "${INPUT}: ${companionOnly} of ${group}_DEVICE BY_SDK ${level} is not built in")
+            endif ()
+        endforeach ()
+    endforeach ()
+
+    # One record per SDK level that changes a field, the first one counting them
+    chain_sdk_levels(${group}_DEVICE levels)
+    set(records "")
+    set(previous "")
+    set(variants 0)
+    foreach (sdk IN LISTS levels)
+        set(values "")
+        foreach (field IN LISTS FIELDS)
+            resolve_field(${group}_DEVICE ${field} ${sdk} value)
+            list(APPEND values "${value}")
+        endforeach ()
+        list(JOIN values ", " values)
+        if (variants GREATER 0 AND values STREQUAL previous)
+            continue()
+        endif ()
+        set(previous "${values}")
+        list(APPEND records "${sdk}@${values}")
+        math(EXPR variants "${variants} + 1")
+    endforeach ()
+    set(first ${variants})
+    foreach (record IN LISTS records)
+        string(FIND "${record}" "@" split)
+        string(SUBSTRING "${record}" 0 ${split} sdk)
+        math(EXPR split "${split} + 1")
+        string(SUBSTRING "${record}" ${split} -1 values)
+        set(comment ${group}_DEVICE)
+        if (sdk GREATER 0)
+            string(APPEND comment " BY_SDK ${sdk}")
+        endif ()
+        string(APPEND profiles "    {${sdk}, ${first}, {${values}}},  // ${comment}\n")
+        set(first 0)
+    endforeach ()
+
+    string(JSON entryCount LENGTH "${config}" ${group})
+    if (entryCount GREATER 0)
+        math(EXPR lastEntry "${entryCount} - 1")
+        foreach (entry RANGE ${lastEntry})
+            string(JSON package GET "${config}" ${group} ${entry})
+            if (package MATCHES "@")
+                message(WARNING "${INPUT}: ${package} is bound to one user and not built in")
+            elseif (NOT package MATCHES "^[A-Za-z0-9_.]+$")
+                message(WARNING "${INPUT}: invalid package entry in ${group}: ${package}")
+            elseif (NOT package IN_LIST seen)
+                list(APPEND seen ${package})
+                string(APPEND packages "    {\"${package}\", ${profileCount}},\n")
+                math(EXPR packageCount "${packageCount} + 1")
+            endif ()
+        endforeach ()
+    endif ()
+    math(EXPR profileCount "${profileCount} + ${variants}")
+endforeach ()
+
+file(CONFIGURE OUTPUT ${OUTPUT} @ONLY CONTENT [[
+// Generated by cmake/builtin_config.cmake from @INPUT@; do not edit
+#pragma once
+
+static constexpr std::array<BuiltinProfile, @profileCount@> BUILTIN_PROFILES = {{
+@profiles@}};
+
+static constexpr std::array<BuiltinPackage, @packageCount@> BUILTIN_PACKAGES = {{
+@packages@}};
+]])
@@ -0,0 +1,131 @@
+# Size and load-cost profile of shared libraries, from readelf output
+#
+#   cmake -DREADELF=<readelf> -DLABEL=<abi> -DLIBRARIES=<a.so;b.so> -P so_report.cmake
+#
+# Works with GNU readelf and llvm-readelf alike. Reported per library:
+#   - bytes of code, read-only data, writable data, bss and dynamic
+#     linking metadata, grouped by section;
+#   - dynamic relocations per relocation section, with the number of
+#     relative ones (the ones RELR packs);
+#   - symbols exported with default visibility;
+#   - static initializers, i.e. .init_array entries.
+
+cmake_minimum_required(VERSION 3.22.1)
+
+if (NOT READELF OR NOT LIBRARIES)
+    message(FATAL_ERROR "usage: cmake -DREADELF=... -DLIBRARIES=... [-DLABEL=...] -P so_report.cmake")
+endif ()
+
+set(TEXT_SECTIONS .text .plt .plt.got .plt.sec .init .fini)
+set(RODATA_SECTIONS .rodata .eh_frame .eh_frame_hdr .gcc_except_table .ARM.exidx .ARM.extab)
+set(DATA_SECTIONS .data .data.rel.ro .got .got.plt .init_array .fini_array .dynamic)
+set(BSS_SECTIONS .bss)
+set(LINKING_SECTIONS .dynsym .dynstr .hash .gnu.hash .gnu.version .gnu.version_r .gnu.version_d
+    .rela.dyn .rel.dyn .rela.plt .rel.plt .relr.dyn .android.rela.dyn .android.rel.dyn)
+
+function(run_readelf out)
+    execute_process(COMMAND ${READELF} -W ${ARGN}
+        OUTPUT_VARIABLE output
+        RESULT_VARIABLE result
+        ERROR_QUIET)
+    if (NOT result EQUAL 0)
+        message(FATAL_ERROR "${READELF} ${ARGN} failed")
+    endif ()
+    string(REPLACE ";" "\\;" output "${output}")
+    string(REPLACE "\n" ";" output "${output}")
+    set(${out} "${output}" PARENT_SCOPE)
+endfunction()
+
+function(report library)
+    get_filename_component(name ${library} NAME)
+    file(SIZE ${library} fileSize)
+    message("${name}${LABEL_SUFFIX}: ${fileSize} bytes on disk")
+
+    # Section sizes
+    run_readelf(lines -h ${library})
+    set(pointerSize 8)
+    foreach (line IN LISTS lines)
+        if (line MATCHES "Class:[ \t]+ELF32")
+            set(pointerSize 4)
+        endif ()
+    endforeach ()
+
+    foreach (group TEXT RODATA DATA BSS LINKING)
+        set(${group}_bytes 0)
+        set(${group}_names "")
+    endforeach ()
+    set(initArrayBytes 0)
+    run_readelf(lines -S ${library})
+    foreach (line IN LISTS lines)
+        if (NOT line MATCHES "\\] +([^ ]+) +[A-Z_0-9]+ +[0-9a-f]+ +[0-9a-f]+ +([0-9a-f]+) ")
+            continue()
+        endif ()
+        set(section ${CMAKE_MATCH_1})
+        math(EXPR size "0x${CMAKE_MATCH_2}")
+        if (section STREQUAL ".init_array")
+            set(initArrayBytes ${size})
+        endif ()
+        foreach (group TEXT RODATA DATA BSS LINKING)
+            if (section IN_LIST ${group}_SECTIONS)
+                math(EXPR ${group}_bytes "${${group}_bytes} + ${size}")
+                list(APPEND ${group}_names "${section} ${size}")
+            endif ()
+        endforeach ()
+    endforeach ()
+
+    foreach (group TEXT RODATA DATA BSS LINKING)
+        string(TOLOWER ${group} label)
+        list(JOIN ${group}_names ", " detail)
+        message("  ${label}\t${${group}_bytes}\t(${detail})")
+    endforeach ()
+
+    # Dynamic relocations
+    run_readelf(lines -r ${library})
+    set(section "")
+    foreach (line IN LISTS lines)
+        if (line MATCHES "Relocation section '([^']+)' at offset [^ ]+ contains ([0-9]+) entr")
+            if (section)
+                message("  relocs\t${count}\t(${section}, ${relative} relative)")
+            endif ()
+            set(section ${CMAKE_MATCH_1})
+            set(count ${CMAKE_MATCH_2})
+            set(relative 0)
+        elseif (section AND line MATCHES "_RELATIVE")
+            math(EXPR relative "${relative} + 1")
+        endif ()
+    endforeach ()
+    if (section)
+        message("  relocs\t${count}\t(${section}, ${relative} relative)")
+    endif ()
+
+    # Exports: defined, global or weak, default visibility
+    run_readelf(lines --dyn-syms ${library})
+    set(exports "")
+    foreach (line IN LISTS lines)
+        if (line MATCHES "^ *[0-9]+: [0-9a-f]+ +[0-9]+ +[A-Z_]+ +(GLOBAL|WEAK) +DEFAULT +([0-9A-Z]+) +([^ @]+)"
+                AND NOT CMAKE_MATCH_2 STREQUAL "UND")
+            list(APPEND exports ${CMAKE_MATCH_3})
+        endif ()
+    endforeach ()
+    list(SORT exports)
+    list(LENGTH exports exportCount)
+    if (exportCount GREATER 8)
+        list(FILTER exports EXCLUDE REGEX "^_Z")
+        list(LENGTH exports plainCount)
+        math(EXPR mangled "${exportCount} - ${plainCount}")
+        list(APPEND exports "+${mangled} C++")
+    endif ()
+    list(JOIN exports " " exportNames)
+    message("  exports\t${exportCount}\t(${exportNames})")
+
+    # One slot per initializer; crtbegin contributes frame_dummy on glibc
+    math(EXPR initializers "${initArrayBytes} / ${pointerSize}")
+    message("  init\t${initializers}\t(.init_array ${initArrayBytes})")
+endfunction()
+
+if (LABEL)
+    set(LABEL_SUFFIX " [${LABEL}]")
+endif ()
+foreach (library IN LISTS LIBRARIES)
+    report(${library})
+endforeach ()
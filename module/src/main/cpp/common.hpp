@@ -0,0 +1,79 @@
+#pragma once
+
+#include <android/log.h>
+#include <time.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+
+// -----------------------------------------------------------
+// Logging
+//
+// The level is fixed at compile time: debug builds log everything, release
+// builds keep errors only and LOGD disappears together with its arguments.
+// -----------------------------------------------------------
+#define COPG_LOG_LEVEL_ERROR 1
+#define COPG_LOG_LEVEL_DEBUG 2
+
+#ifndef COPG_LOG_LEVEL
+#define COPG_LOG_LEVEL COPG_LOG_LEVEL_ERROR
+#endif
+
+#define LOG_TAG "CombinedSpoofModule"
+#if COPG_LOG_LEVEL >= COPG_LOG_LEVEL_DEBUG
+#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
+#else
+#define LOGD(...) ((void) 0)
+#endif
+#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
+
+#ifndef MODULE_DIR
+#define MODULE_DIR "/data/adb/modules/COPG"
+#endif
+
+#define CONFIG_PATH MODULE_DIR "/config.json"
+#define CONFIG_DIR_PATH MODULE_DIR "/config.d"  // *.json fragments, merged after config.json
+
+#ifndef PACKAGES_LIST_PATH
+#define PACKAGES_LIST_PATH "/data/system/packages.list"
+#endif
+
+// -----------------------------------------------------------
+// Safe read/write functions
+// -----------------------------------------------------------
+static inline ssize_t xread(int fd, void *buffer, size_t count) {
+    ssize_t total = 0;
+    char *buf = (char *) buffer;
+    while (count > 0) {
+        ssize_t ret = TEMP_FAILURE_RETRY(read(fd, buf, count));
+        if (ret < 0) return -1;
+        if (ret == 0) break; // Peer closed the connection
+        buf += ret;
+        total += ret;
+        count -= ret;
+    }
+    return total;
+}
+
+static inline ssize_t xwrite(int fd, const void *buffer, size_t count) {
+    ssize_t total = 0;
+    char *buf = (char *) buffer;
+    while (count > 0) {
+        ssize_t ret = TEMP_FAILURE_RETRY(write(fd, buf, count));
+        if (ret < 0) return -1;
+        buf += ret;
+        total += ret;
+        count -= ret;
+    }
+    return total;
+}
+
+// -----------------------------------------------------------
+// Monotonic clock, vDSO-backed and cheap enough for spans
+// -----------------------------------------------------------
+static inline uint64_t monotonicNs() {
+    timespec ts{};
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000u + ts.tv_nsec;
+}
@@ -0,0 +1,1118 @@
+#include <dirent.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <charconv>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "binlog.hpp"
+#include "common.hpp"
+#include "profile.hpp"
+#include "protocol.hpp"
+#include "stats.hpp"
+#include "trace.hpp"
+
+#define JSON_NOEXCEPTION 1
+#define JSON_NO_IO 1
+#include "json.hpp"
+
+// -----------------------------------------------------------
+// File reading utilities with enhanced error handling
+// -----------------------------------------------------------
+static std::vector<uint8_t> readFile(const char *path) {
+    if (!path) {
+        LOGE("Invalid path provided to readFile");
+        return {};
+    }
+
+    FILE *file = fopen(path, "rb");
+    if (!file) {
+        LOGE("Failed to open configuration file: %s (error: %s)", path, strerror(errno));
+        return {};
+    }
+
+    // Get file size
+    if (fseek(file, 0, SEEK_END) != 0) {
+        LOGE("Failed to seek to end of file: %s", path);
+        fclose(file);
+        return {};
+    }
+
+    long size = ftell(file);
+    if (size < 0) {
+        LOGE("Failed to get file size: %s", path);
+        fclose(file);
+        return {};
+    }
+
+    if (fseek(file, 0, SEEK_SET) != 0) {
+        LOGE("Failed to seek to beginning of file: %s", path);
+        fclose(file);
+        return {};
+    }
+
+    if (size == 0) {
+        LOGD("Configuration file is empty: %s", path);
+        fclose(file);
+        return {};
+    }
+
+    // Read file contents
+    std::vector<uint8_t> buffer(size);
+    size_t bytesRead = fread(buffer.data(), 1, size, file);
+    fclose(file);
+
+    if (bytesRead != static_cast<size_t>(size)) {
+        LOGE("Failed to read complete file: %s (read %zu/%ld bytes)",
+             path, bytesRead, size);
+        return {};
+    }
+
+    LOGD("Successfully read configuration file: %s (%ld bytes)", path, size);
+    return buffer;
+}
+
+// -----------------------------------------------------------
+// SDK level of the running system
+//
+// Read once per companion: it only changes with an OS update, which
+// reboots, so every config compiled in this boot selects the same BY_SDK
+// entries and lookups never look at it.
+// -----------------------------------------------------------
+static uint32_t runningSdkLevel() {
+    static const uint32_t level = [] {
+        char value[PROP_VALUE_MAX] = {};
+        uint32_t sdk = 0;
+        __system_property_get("ro.build.version.sdk", value);
+        std::from_chars(value, value + strlen(value), sdk);
+        LOGD("Running SDK level: %u", sdk);
+        return sdk;
+    }();
+    return level;
+}
+
+// -----------------------------------------------------------
+// Installed packages, as recorded by PackageManager
+//
+// Each line of packages.list starts with "<package> <appId> ...", which is
+// the only place mapping names to app ids without going through Java.
+// -----------------------------------------------------------
+struct InstalledPackage {
+    std::string name;
+    uint32_t appId;
+};
+
+static std::vector<InstalledPackage> parsePackagesList(const std::vector<uint8_t> &data) {
+    std::vector<InstalledPackage> packages;
+    std::string_view text(reinterpret_cast<const char *>(data.data()), data.size());
+
+    while (!text.empty()) {
+        size_t eol = text.find('\n');
+        std::string_view line = text.substr(0, eol);
+        text = eol == std::string_view::npos ? std::string_view() : text.substr(eol + 1);
+
+        size_t nameEnd = line.find(' ');
+        if (nameEnd == std::string_view::npos || nameEnd == 0) continue;
+
+        uint32_t appId = 0;
+        std::string_view rest = line.substr(nameEnd + 1);
+        auto [ptr, ec] = std::from_chars(rest.data(), rest.data() + rest.size(), appId);
+        if (ec != std::errc() || ptr == rest.data()) continue;
+
+        packages.push_back({std::string(line.substr(0, nameEnd)), appId});
+    }
+    return packages;
+}
+
+// -----------------------------------------------------------
+// Compiled configuration: (userId, appId) -> device profile
+//
+// Profile values are stored once in a string pool and profiles refer to
+// them by offset, so a brand or fingerprint shared by a family of profiles
+// takes the space of one. Inheritance is flattened while compiling: a
+// lookup is a single record fetch however deep the chain was.
+//
+// Every property a profile sets, the standard ones derived from its fields
+// and its PROPS alike, is compiled into one name-sorted array of offset
+// pairs, which the app applies in a single pass. SOC entries are kept the
+// same way in an array of their own.
+// -----------------------------------------------------------
+
+// NUL-terminated strings back to back; offset 0 is the empty string
+struct StringPool {
+    std::vector<char> data{'\0'};
+
+    const char *at(uint32_t offset) const { return data.data() + offset; }
+
+    uint32_t append(std::string_view text) {
+        auto offset = static_cast<uint32_t>(data.size());
+        data.insert(data.end(), text.begin(), text.end());
+        data.push_back('\0');
+        return offset;
+    }
+};
+
+// StringPool offsets; a value of 0 means the property is not set
+struct PropertyEntry {
+    uint32_t name;
+    uint32_t value;
+};
+
+struct CompiledProfile {
+    uint32_t fields[PROFILE_FIELD_COUNT];  // StringPool offsets
+    uint32_t propertiesBegin;              // Into ConfigFragment::properties
+    uint32_t propertyCount;
+    uint32_t propertyBytes;                // Serialized, at most PROPERTY_TAIL_MAX
+    uint32_t socBegin;                     // Into ConfigFragment::socEntries
+    uint32_t socCount;
+    uint32_t socBytes;                     // Serialized, at most SOC_TAIL_MAX
+};
+
+struct ProcessRules {
+    bool all = false;
+    std::vector<std::string> names;  // ":name" or full process names
+};
+
+struct PackageBinding {
+    uint32_t userId;
+    uint32_t profile;  // Into ConfigFragment::profiles
+    uint32_t group;    // Into ConfigFragment::groups
+};
+
+// One config file compiled on its own. Nothing in it depends on the
+// package list or on other files, so it is only rebuilt when its file
+// changes.
+struct ConfigFragment {
+    StringPool strings;
+    std::vector<CompiledProfile> profiles;
+    std::vector<PropertyEntry> properties;
+    std::vector<PropertyEntry> socEntries;
+    std::vector<ProcessRules> groups;
+    std::unordered_map<std::string, std::vector<PackageBinding>> bindings;  // By package name
+
+    // record must be zeroed; every value fits, lengths are checked on compile
+    void materialize(const CompiledProfile &profile, ProfileRecord &record) const {
+        size_t index = 0;
+        DeviceConfig::forEachField(record.config, [&](DeviceConfig::Field &field) {
+            strcpy(field, strings.at(profile.fields[index++]));
+        });
+        record.propertyCount = profile.propertyCount;
+        record.propertyBytes = profile.propertyBytes;
+        record.socCount = profile.socCount;
+        record.socBytes = profile.socBytes;
+    }
+
+    // Writes the property pairs and then the SoC entry pairs,
+    // propertyBytes + socBytes in total, to out
+    void writeTail(const CompiledProfile &profile, char *out) const {
+        out = writeEntries(properties, profile.propertiesBegin, profile.propertyCount, out);
+        writeEntries(socEntries, profile.socBegin, profile.socCount, out);
+    }
+
+private:
+    char *writeEntries(const std::vector<PropertyEntry> &entries, uint32_t begin, uint32_t count, char *out) const {
+        for (uint32_t i = 0; i < count; i++) {
+            const PropertyEntry &entry = entries[begin + i];
+            for (uint32_t offset : {entry.name, entry.value}) {
+                const char *text = strings.at(offset);
+                size_t length = strlen(text) + 1;
+                memcpy(out, text, length);
+                out += length;
+            }
+        }
+        return out;
+    }
+};
+
+struct AppBinding {
+    uint32_t fragment;        // Into ConfigSnapshot::fragments
+    uint32_t profile;         // Into the profiles of that fragment
+    uint32_t package;         // StringPool offset, also the main process name
+    uint32_t processesBegin;  // Into ConfigSnapshot::processes
+    uint32_t processCount;    // Further spoofed process names
+    bool allProcesses;
+};
+
+// The fragments linked against the installed packages
+struct ConfigSnapshot {
+    std::vector<std::shared_ptr<const ConfigFragment>> fragments;
+    StringPool strings;               // Package and process names
+    std::vector<uint32_t> processes;  // StringPool offsets of full process names
+    std::unordered_map<uint64_t, AppBinding> apps;
+
+    // A profile bound to this exact user wins over one that applies to all users
+    const AppBinding *find(AppKey key) const {
+        auto it = apps.find(key.packed());
+        if (it == apps.end()) it = apps.find(AppKey{ANY_USER, key.appId}.packed());
+        return it == apps.end() ? nullptr : &it->second;
+    }
+
+    // The main process is always spoofed; a request without a name is
+    // taken to be it
+    bool spoofsProcess(const AppBinding &app, const LookupRequest &request) const {
+        if (app.allProcesses || request.processLength == 0) return true;
+        if (request.processLength >= PROCESS_NAME_MAX) return false;
+
+        const char *name = request.process;
+        if (!strcmp(name, strings.at(app.package))) return true;
+        for (uint32_t i = 0; i < app.processCount; i++) {
+            if (!strcmp(name, strings.at(processes[app.processesBegin + i]))) return true;
+        }
+        return false;
+    }
+};
+
+class ConfigCompiler {
+public:
+    // Compiles one config file. Groups are visited in key order and the
+    // first group listing a package wins. A package entry may be
+    // qualified as "<package>@<userId>" to bind it to a single user.
+    //
+    // A profile may name another top-level object in "extends" and only
+    // override what differs; the base does not need packages of its own,
+    // but it has to live in the same file. Arbitrary properties go into a
+    // "PROPS" object of name/value strings; they are inherited the same way
+    // and an empty value unsets one.
+    //
+    // A "SOC" object, inherited the same way, makes the app serve
+    // synthesized SoC files: "cpuinfo" is the Hardware line of /proc/cpuinfo,
+    // any other name a file under /sys/devices/soc0, e.g. "machine",
+    // "soc_id" or "family".
+    //
+    // A "BY_SDK" object maps SDK levels to fields, PROPS and SOC of their
+    // own; the entry with the greatest level not above the running one is
+    // layered over the rest of the profile, so a fingerprint can follow the
+    // OS release it runs on.
+    //
+    // "PACKAGES_<group>_PROCESSES" lists further processes of the group's
+    // packages to spoof besides the main one: ":name" for a private process
+    // of each package, a full process name, or "*" for all of them.
+    //
+    // "PACKAGES_<group>_OVERRIDES" maps a package of the group to fields,
+    // PROPS and BY_SDK layered over the group profile. Each overridden
+    // package gets a flat record of its own, so lookups stay a single probe.
+    static std::shared_ptr<const ConfigFragment> compile(const char *path, const std::vector<uint8_t> &data) {
+        auto fragment = std::make_shared<ConfigFragment>();
+        if (data.empty()) return fragment;
+
+        auto configJson = nlohmann::json::parse(data.begin(), data.end(), nullptr, false, true);
+        if (configJson.is_discarded() || !configJson.is_object()) {
+            LOGE("Failed to parse JSON configuration %s - invalid format", path);
+            return fragment;
+        }
+
+        ConfigCompiler compiler(configJson, fragment->strings);
+        auto &bindings = fragment->bindings;
+        auto &groups = fragment->groups;
+
+        for (auto &[key, value] : configJson.items()) {
+            if (!value.is_array() || key.find("PACKAGES_") != 0) {
+                continue;
+            }
+
+            std::string deviceConfigKey = key + "_DEVICE";
+            auto deviceNode = configJson.find(deviceConfigKey);
+            if (deviceNode == configJson.end() || !deviceNode->is_object()) {
+                LOGE("Device configuration %s not found", deviceConfigKey.c_str());
+                continue;
+            }
+
+            ResolvedProfile groupProfile = compiler.resolve(deviceConfigKey);
+            auto profileIndex = static_cast<uint32_t>(fragment->profiles.size());
+            fragment->profiles.push_back(compiler.finalize(deviceConfigKey, groupProfile, *fragment));
+
+            std::string overridesKey = key + "_OVERRIDES";
+            auto overrides = configJson.find(overridesKey);
+            if (overrides != configJson.end() && !overrides->is_object()) {
+                LOGE("%s must map packages to fields", overridesKey.c_str());
+                overrides = configJson.end();
+            }
+            // package -> profile, shared by the user-qualified entries of one package
+            std::unordered_map<std::string, uint32_t> overridden;
+
+            auto group = static_cast<uint32_t>(groups.size());
+            groups.push_back(parseProcessRules(configJson, key + "_PROCESSES"));
+
+            for (const auto &pkg : value) {
+                if (!pkg.is_string()) continue;
+
+                std::string_view entry = pkg.get_ref<const std::string &>();
+                uint32_t userId = ANY_USER;
+                if (!parseUserQualifier(entry, userId)) {
+                    LOGE("Invalid package entry in %s: %s", key.c_str(), pkg.get_ref<const std::string &>().c_str());
+                    continue;
+                }
+
+                uint32_t packageProfile = profileIndex;
+                const nlohmann::json *override = nullptr;
+                if (overrides != configJson.end()) {
+                    auto it = overrides->find(std::string(entry));
+                    if (it != overrides->end() && it->is_object()) override = &*it;
+                }
+                if (override) {
+                    auto [it, inserted] = overridden.try_emplace(std::string(entry), 0);
+                    if (inserted) {
+                        std::string overrideKey = overridesKey + "." + it->first;
+                        ResolvedProfile packageFields = groupProfile;
+                        compiler.apply(overrideKey, *override, packageFields);
+                        it->second = static_cast<uint32_t>(fragment->profiles.size());
+                        fragment->profiles.push_back(compiler.finalize(overrideKey, packageFields, *fragment));
+                    }
+                    packageProfile = it->second;
+                }
+                bindings[std::string(entry)].push_back({userId, packageProfile, group});
+            }
+
+            if (overrides == configJson.end()) continue;
+            for (auto &[package, fields] : overrides->items()) {
+                if (!fields.is_object()) {
+                    LOGE("%s: fields of %s must be an object", overridesKey.c_str(), package.c_str());
+                } else if (!overridden.count(package)) {
+                    LOGE("%s: %s is not listed in %s", overridesKey.c_str(), package.c_str(), key.c_str());
+                }
+            }
+        }
+
+        LOGD("Compiled %s for SDK %u: %zu profiles, %zu packages, %zu properties, %zu bytes of strings", path,
+             compiler.sdkLevel, fragment->profiles.size(), bindings.size(), fragment->properties.size(), fragment->strings.data.size());
+        return fragment;
+    }
+
+    // Binds the packages of every fragment to installed app ids. Fragments
+    // are in precedence order: for each (userId, appId) the first binding
+    // wins. Packages sharing an app id (sharedUserId) within one fragment
+    // are taken by name, so the lowest one wins on every link. Only walks
+    // the bindings, no JSON is looked at again.
+    static std::shared_ptr<ConfigSnapshot> link(std::vector<std::shared_ptr<const ConfigFragment>> fragments,
+                                                const std::vector<InstalledPackage> &installed) {
+        auto snapshot = std::make_shared<ConfigSnapshot>();
+        snapshot->fragments = std::move(fragments);
+
+        std::unordered_map<std::string_view, uint32_t> appIds;
+        for (const auto &package : installed) appIds.emplace(package.name, package.appId);
+
+        using Bindings = std::pair<const std::string, std::vector<PackageBinding>>;
+        std::vector<const Bindings *> listed;
+        for (uint32_t index = 0; index < snapshot->fragments.size(); index++) {
+            const ConfigFragment &fragment = *snapshot->fragments[index];
+            listed.clear();
+            for (const auto &entry : fragment.bindings) {
+                if (appIds.count(entry.first)) listed.push_back(&entry);
+            }
+            std::sort(listed.begin(), listed.end(),
+                      [](const Bindings *a, const Bindings *b) { return a->first < b->first; });
+
+            for (const Bindings *entry : listed) {
+                const std::string &package = entry->first;
+                uint32_t appId = appIds.find(package)->second;
+                uint32_t packageName = 0;
+                for (const auto &binding : entry->second) {
+                    uint64_t key = AppKey{binding.userId, appId}.packed();
+                    auto bound = snapshot->apps.find(key);
+                    if (bound != snapshot->apps.end()) {
+                        const char *winner = snapshot->strings.at(bound->second.package);
+                        if (package != winner) {
+                            LOGE("%s shares app id %u with %s, which takes precedence", package.c_str(), appId,
+                                 winner);
+                        }
+                        continue;
+                    }
+
+                    if (!packageName) packageName = snapshot->strings.append(package);
+                    const ProcessRules &rules = fragment.groups[binding.group];
+                    AppBinding app{index, binding.profile, packageName,
+                                   static_cast<uint32_t>(snapshot->processes.size()), 0, rules.all};
+                    for (const auto &name : rules.names) {
+                        std::string process = name[0] == ':' ? package + name : name;
+                        snapshot->processes.push_back(snapshot->strings.append(process));
+                        app.processCount++;
+                    }
+                    snapshot->apps.emplace(key, app);
+                }
+            }
+        }
+
+        LOGD("Linked %zu config files: %zu app keys", snapshot->fragments.size(), snapshot->apps.size());
+        return snapshot;
+    }
+
+private:
+    // Field not set anywhere along the chain yet; stored as the empty string
+    static constexpr uint32_t UNSET = UINT32_MAX;
+
+    // A profile with its chain applied, before it goes into the snapshot
+    struct ResolvedProfile {
+        uint32_t fields[PROFILE_FIELD_COUNT];
+        std::vector<PropertyEntry> properties;  // Sorted by name
+        std::vector<PropertyEntry> soc;         // Sorted by name
+    };
+
+    const nlohmann::json &config;
+    StringPool &strings;
+    std::unordered_map<std::string, uint32_t> interned;
+    std::unordered_map<std::string, ResolvedProfile> resolved;
+    std::vector<std::string> resolving;
+    uint32_t derivedNames[DERIVED_PROPERTY_COUNT];  // StringPool offsets
+    uint32_t sdkLevel;
+
+    ConfigCompiler(const nlohmann::json &config, StringPool &strings)
+        : config(config), strings(strings), sdkLevel(runningSdkLevel()) {
+        for (size_t i = 0; i < DERIVED_PROPERTY_COUNT; i++) {
+            derivedNames[i] = intern(DERIVED_PROPERTIES[i].name);
+        }
+    }
+
+    // Flattened fields and PROPS of the profile at key, bases first; UNSET
+    // where nothing along the chain sets a field
+    ResolvedProfile resolve(const std::string &key) {
+        auto cached = resolved.find(key);
+        if (cached != resolved.end()) return cached->second;
+
+        ResolvedProfile profile;
+        for (uint32_t &field : profile.fields) field = UNSET;
+
+        auto node = config.find(key);
+        if (node == config.end() || !node->is_object()) {
+            LOGE("Profile %s not found", key.c_str());
+            return profile;
+        }
+        for (const auto &pending : resolving) {
+            if (pending == key) {
+                LOGE("Profile %s extends itself", key.c_str());
+                return profile;
+            }
+        }
+
+        auto base = node->find("extends");
+        if (base != node->end()) {
+            if (base->is_string()) {
+                resolving.push_back(key);
+                profile = resolve(base->get_ref<const std::string &>());
+                resolving.pop_back();
+            } else {
+                LOGE("Profile %s: extends must name another profile", key.c_str());
+            }
+        }
+
+        apply(key, *node, profile);
+        resolved.emplace(key, profile);
+        return profile;
+    }
+
+    // Layers the fields, PROPS and SOC set by node, the object at key, over
+    // profile, then those of the BY_SDK entry selected for the running level
+    void apply(const std::string &key, const nlohmann::json &node, ResolvedProfile &profile) {
+        for (size_t i = 0; i < PROFILE_FIELD_COUNT; i++) {
+            auto it = node.find(PROFILE_KEYS[i]);
+            if (it == node.end() || !it->is_string()) continue;
+
+            const auto &value = it->get_ref<const std::string &>();
+            if (value.size() >= PROP_VALUE_MAX) {
+                LOGE("Value of %s exceeds %d bytes, ignoring: %s", PROFILE_KEYS[i], PROP_VALUE_MAX - 1, value.c_str());
+                continue;
+            }
+            profile.fields[i] = intern(value);
+        }
+
+        auto props = node.find("PROPS");
+        if (props != node.end() && !props->is_object()) {
+            LOGE("Profile %s: PROPS must be an object", key.c_str());
+        } else if (props != node.end()) {
+            for (auto &[name, value] : props->items()) {
+                if (!value.is_string() || name.empty() || name.find('\0') != std::string::npos) {
+                    LOGE("Profile %s: invalid property %s", key.c_str(), name.c_str());
+                    continue;
+                }
+                const auto &text = value.get_ref<const std::string &>();
+                if (text.size() >= PROP_VALUE_MAX || text.find('\0') != std::string::npos) {
+                    LOGE("Value of %s exceeds %d bytes, ignoring: %s", name.c_str(), PROP_VALUE_MAX - 1, text.c_str());
+                    continue;
+                }
+                setProperty(profile.properties, intern(name), intern(text));
+            }
+        }
+
+        // SOC names become file names, so they are kept to [a-z0-9_]
+        auto soc = node.find("SOC");
+        if (soc != node.end() && !soc->is_object()) {
+            LOGE("Profile %s: SOC must be an object", key.c_str());
+        } else if (soc != node.end()) {
+            for (auto &[name, value] : soc->items()) {
+                bool valid = value.is_string() && !name.empty() && name.size() < SOC_NAME_MAX;
+                for (char c : name) valid = valid && ((c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_');
+                if (!valid) {
+                    LOGE("Profile %s: invalid SOC entry %s", key.c_str(), name.c_str());
+                    continue;
+                }
+                const auto &text = value.get_ref<const std::string &>();
+                if (text.size() >= PROP_VALUE_MAX || text.find_first_of(std::string_view("\0\n", 2)) != std::string::npos) {
+                    LOGE("Value of SOC %s exceeds %d bytes or spans lines, ignoring: %s", name.c_str(),
+                         PROP_VALUE_MAX - 1, text.c_str());
+                    continue;
+                }
+                setProperty(profile.soc, intern(name), intern(text));
+            }
+        }
+
+        auto bySdk = node.find("BY_SDK");
+        if (bySdk != node.end()) {
+            if (const nlohmann::json *entry = selectSdkEntry(key, *bySdk)) apply(key, *entry, profile);
+        }
+    }
+
+    // The entry of bySdk with the greatest level not above sdkLevel, if any
+    const nlohmann::json *selectSdkEntry(const std::string &key, const nlohmann::json &bySdk) const {
+        if (!bySdk.is_object()) {
+            LOGE("Profile %s: BY_SDK must be an object", key.c_str());
+            return nullptr;
+        }
+        const nlohmann::json *selected = nullptr;
+        uint32_t selectedLevel = 0;
+        for (auto &[name, entry] : bySdk.items()) {
+            uint32_t level = 0;
+            auto [ptr, ec] = std::from_chars(name.data(), name.data() + name.size(), level);
+            if (ec != std::errc() || ptr != name.data() + name.size() || !entry.is_object() ||
+                entry.contains("BY_SDK")) {
+                LOGE("Profile %s: invalid BY_SDK entry %s", key.c_str(), name.c_str());
+                continue;
+            }
+            if (level <= sdkLevel && (!selected || level > selectedLevel)) {
+                selected = &entry;
+                selectedLevel = level;
+            }
+        }
+        return selected;
+    }
+
+    // The snapshot form of a resolved profile: derived properties first,
+    // PROPS over them, unset ones dropped
+    CompiledProfile finalize(const std::string &key, const ResolvedProfile &resolvedProfile, ConfigFragment &fragment) {
+        CompiledProfile profile{};
+        for (uint32_t i = 0; i < PROFILE_FIELD_COUNT; i++) {
+            profile.fields[i] = resolvedProfile.fields[i] == UNSET ? 0 : resolvedProfile.fields[i];
+        }
+
+        std::vector<PropertyEntry> properties;
+        for (size_t i = 0; i < DERIVED_PROPERTY_COUNT; i++) {
+            setProperty(properties, derivedNames[i], profile.fields[DERIVED_PROPERTIES[i].field]);
+        }
+        for (const auto &entry : resolvedProfile.properties) {
+            setProperty(properties, entry.name, entry.value);
+        }
+
+        profile.propertiesBegin = static_cast<uint32_t>(fragment.properties.size());
+        for (const auto &entry : properties) {
+            if (!entry.value) continue;
+            size_t bytes = strlen(strings.at(entry.name)) + strlen(strings.at(entry.value)) + 2;
+            if (profile.propertyBytes + bytes > PROPERTY_TAIL_MAX) {
+                LOGE("Profile %s: properties exceed %u bytes, dropping %s and after",
+                     key.c_str(), PROPERTY_TAIL_MAX, strings.at(entry.name));
+                break;
+            }
+            fragment.properties.push_back(entry);
+            profile.propertyCount++;
+            profile.propertyBytes += static_cast<uint32_t>(bytes);
+        }
+
+        profile.socBegin = static_cast<uint32_t>(fragment.socEntries.size());
+        for (const auto &entry : resolvedProfile.soc) {
+            if (!entry.value) continue;
+            size_t bytes = strlen(strings.at(entry.name)) + strlen(strings.at(entry.value)) + 2;
+            if (profile.socBytes + bytes > SOC_TAIL_MAX) {
+                LOGE("Profile %s: SOC exceeds %u bytes, dropping %s and after",
+                     key.c_str(), SOC_TAIL_MAX, strings.at(entry.name));
+                break;
+            }
+            fragment.socEntries.push_back(entry);
+            profile.socCount++;
+            profile.socBytes += static_cast<uint32_t>(bytes);
+        }
+        return profile;
+    }
+
+    // Inserts or replaces name, keeping properties sorted by name
+    void setProperty(std::vector<PropertyEntry> &properties, uint32_t name, uint32_t value) const {
+        auto it = std::lower_bound(properties.begin(), properties.end(), name,
+                                   [this](const PropertyEntry &entry, uint32_t offset) {
+                                       return strcmp(strings.at(entry.name), strings.at(offset)) < 0;
+                                   });
+        if (it != properties.end() && it->name == name) {
+            it->value = value;
+        } else {
+            properties.insert(it, {name, value});
+        }
+    }
+
+    uint32_t intern(std::string_view value) {
+        if (value.empty()) return 0;
+        auto [it, inserted] = interned.try_emplace(std::string(value), 0);
+        if (inserted) it->second = strings.append(value);
+        return it->second;
+    }
+
+    static ProcessRules parseProcessRules(const nlohmann::json &config, const std::string &key) {
+        ProcessRules rules;
+        auto node = config.find(key);
+        if (node == config.end()) return rules;
+        if (!node->is_array()) {
+            LOGE("%s must be an array of process names", key.c_str());
+            return rules;
+        }
+        for (const auto &entry : *node) {
+            if (!entry.is_string() || entry.get_ref<const std::string &>().empty() || entry == ":") {
+                LOGE("Invalid process entry in %s", key.c_str());
+                continue;
+            }
+            const auto &name = entry.get_ref<const std::string &>();
+            if (name == "*") {
+                rules.all = true;
+            } else {
+                rules.names.push_back(name);
+            }
+        }
+        return rules;
+    }
+
+    static bool parseUserQualifier(std::string_view &entry, uint32_t &userId) {
+        size_t at = entry.rfind('@');
+        if (at == std::string_view::npos) return !entry.empty();
+
+        std::string_view user = entry.substr(at + 1);
+        auto [ptr, ec] = std::from_chars(user.data(), user.data() + user.size(), userId);
+        if (ec != std::errc() || ptr != user.data() + user.size() || user.empty()) return false;
+
+        entry = entry.substr(0, at);
+        return !entry.empty();
+    }
+};
+
+// -----------------------------------------------------------
+// Snapshot cache. config.json and every config.d/*.json are compiled
+// on their own; a change to one file recompiles that file and relinks,
+// a change to the package list only relinks.
+//
+// Apps booted without a user configuration use the built-in profiles and
+// never ask, so a configuration added after boot is first read here after
+// the next reboot (see post-fs-data.sh).
+// -----------------------------------------------------------
+struct FileStamp {
+    bool exists = false;
+    ino_t inode = 0;
+    off_t size = 0;
+    timespec mtime{};
+
+    static FileStamp of(const char *path) {
+        struct stat st{};
+        if (stat(path, &st) != 0) return {};
+        return {true, st.st_ino, st.st_size, st.st_mtim};
+    }
+
+    bool operator==(const FileStamp &other) const {
+        return exists == other.exists && inode == other.inode && size == other.size &&
+               mtime.tv_sec == other.mtime.tv_sec && mtime.tv_nsec == other.mtime.tv_nsec;
+    }
+    bool operator!=(const FileStamp &other) const { return !(*this == other); }
+};
+
+class SnapshotCache {
+public:
+    // The companion handler runs concurrently on multiple threads, so the
+    // freshness check and the swap happen under one lock.
+    std::shared_ptr<const ConfigSnapshot> acquire() {
+        FileStamp packages = FileStamp::of(PACKAGES_LIST_PATH);
+        FileStamp directory = FileStamp::of(CONFIG_DIR_PATH);
+
+        std::lock_guard<std::mutex> lock(mutex);
+        bool changed = !snapshot;
+        if (sources.empty() || racyListing || directory != directoryStamp) {
+            changed = listSources(directory) || changed;
+            directoryStamp = directory;
+        }
+
+        for (Source &source : sources) {
+            FileStamp stamp = FileStamp::of(source.path.c_str());
+            if (source.fragment && stamp == source.stamp) continue;
+
+            LOGD("%s changed, recompiling it", source.path.c_str());
+            std::vector<uint8_t> data;
+            if (stamp.exists) data = readFile(source.path.c_str());
+            source.fragment = ConfigCompiler::compile(source.path.c_str(), data);
+            source.stamp = stamp;
+            changed = true;
+        }
+
+        if (packages != packagesStamp) {
+            installed.clear();
+            if (packages.exists) installed = parsePackagesList(readFile(PACKAGES_LIST_PATH));
+            packagesStamp = packages;
+            changed = true;
+        }
+        if (!changed) return snapshot;
+
+        std::vector<std::shared_ptr<const ConfigFragment>> fragments;
+        for (const Source &source : sources) fragments.push_back(source.fragment);
+        snapshot = ConfigCompiler::link(std::move(fragments), installed);
+        return snapshot;
+    }
+
+private:
+    // Directory timestamps only move once per kernel tick, so a listing
+    // taken this close to the last change is repeated on the next request
+    static constexpr int64_t LISTING_SETTLE_NS = 50000000;
+
+    struct Source {
+        std::string path;
+        FileStamp stamp;
+        std::shared_ptr<const ConfigFragment> fragment;  // Null until compiled
+    };
+
+    std::mutex mutex;
+    std::shared_ptr<const ConfigSnapshot> snapshot;
+    std::vector<Source> sources;  // config.json, then config.d/*.json by name
+    std::vector<InstalledPackage> installed;
+    FileStamp directoryStamp;
+    FileStamp packagesStamp;
+    bool racyListing = false;
+
+    // Fragments of files that are still listed are kept; returns whether
+    // the list changed
+    bool listSources(const FileStamp &directory) {
+        std::vector<std::string> paths{CONFIG_PATH};
+        if (DIR *dir = opendir(CONFIG_DIR_PATH)) {
+            size_t first = paths.size();
+            while (dirent *entry = readdir(dir)) {
+                std::string_view name = entry->d_name;
+                if (name[0] == '.' || name.size() <= 5 || name.substr(name.size() - 5) != ".json") continue;
+                paths.push_back(std::string(CONFIG_DIR_PATH "/").append(name));
+            }
+            closedir(dir);
+            std::sort(paths.begin() + first, paths.end());
+        }
+
+        timespec now{};
+        clock_gettime(CLOCK_REALTIME, &now);
+        int64_t age = (now.tv_sec - directory.mtime.tv_sec) * 1000000000LL + (now.tv_nsec - directory.mtime.tv_nsec);
+        racyListing = directory.exists && age < LISTING_SETTLE_NS;
+
+        bool same = paths.size() == sources.size();
+        for (size_t i = 0; same && i < paths.size(); i++) same = paths[i] == sources[i].path;
+        if (same) return false;
+
+        std::vector<Source> listed;
+        for (auto &path : paths) {
+            auto it = std::find_if(sources.begin(), sources.end(),
+                                   [&](const Source &source) { return source.path == path; });
+            listed.push_back(it != sources.end() ? std::move(*it) : Source{std::move(path), {}, nullptr});
+        }
+        sources = std::move(listed);
+        return true;
+    }
+};
+
+static SnapshotCache snapshotCache;
+
+// -----------------------------------------------------------
+// Launch statistics
+//
+// Every handler thread records into the histograms and the package table
+// with relaxed atomics and no locks; whichever thread notices that the
+// persist interval has passed writes a copy to STATS_PATH.
+// -----------------------------------------------------------
+#ifndef STATS_PERSIST_INTERVAL_MS
+#define STATS_PERSIST_INTERVAL_MS 10000
+#endif
+
+class AtomicHistogram {
+public:
+    void record(uint32_t ns) {
+        counts[LogLinearBuckets::indexOf(ns)].fetch_add(1, std::memory_order_relaxed);
+        count.fetch_add(1, std::memory_order_relaxed);
+        sumNs.fetch_add(ns, std::memory_order_relaxed);
+    }
+
+    void serialize(LaunchPhase phase, StatsOutcome outcome, std::vector<uint8_t> &out) const {
+        StatsBucket buckets[LogLinearBuckets::COUNT];
+        uint32_t nonZero = 0;
+        for (uint32_t i = 0; i < LogLinearBuckets::COUNT; i++) {
+            uint64_t n = counts[i].load(std::memory_order_relaxed);
+            if (n) buckets[nonZero++] = {i, 0, n};
+        }
+        StatsSeries series{phase, outcome, nonZero, 0,
+                           count.load(std::memory_order_relaxed), sumNs.load(std::memory_order_relaxed)};
+        append(out, &series, sizeof(series));
+        append(out, buckets, nonZero * sizeof(StatsBucket));
+    }
+
+    static void append(std::vector<uint8_t> &out, const void *data, size_t size) {
+        auto bytes = static_cast<const uint8_t *>(data);
+        out.insert(out.end(), bytes, bytes + size);
+    }
+
+private:
+    std::atomic<uint64_t> counts[LogLinearBuckets::COUNT]{};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> sumNs{0};
+};
+
+// Open addressing keyed on AppKey::packed(); slots are claimed with a CAS
+// and never released, 0 marks a free slot (app ids start at 10000)
+class PackageCounters {
+public:
+    enum Counter { HITS, MISSES, TIMEOUTS, COUNTER_COUNT };
+
+    bool add(AppKey key, Counter counter) {
+        uint64_t packed = key.packed();
+        uint32_t start = static_cast<uint32_t>((packed * 0x9e3779b97f4a7c15ull) >> (64 - SLOT_BITS));
+        for (uint32_t probe = 0; probe < SLOT_COUNT; probe++) {
+            Slot &slot = slots[(start + probe) & (SLOT_COUNT - 1)];
+            uint64_t current = slot.key.load(std::memory_order_acquire);
+            if (current == 0 &&
+                slot.key.compare_exchange_strong(current, packed, std::memory_order_acq_rel)) {
+                current = packed;
+            }
+            if (current == packed) {
+                slot.counters[counter].fetch_add(1, std::memory_order_relaxed);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    uint32_t serialize(std::vector<uint8_t> &out) const {
+        uint32_t written = 0;
+        for (const Slot &slot : slots) {
+            uint64_t packed = slot.key.load(std::memory_order_acquire);
+            if (!packed) continue;
+            StatsPackage package{static_cast<uint32_t>(packed >> 32), static_cast<uint32_t>(packed),
+                                 slot.counters[HITS].load(std::memory_order_relaxed),
+                                 slot.counters[MISSES].load(std::memory_order_relaxed),
+                                 slot.counters[TIMEOUTS].load(std::memory_order_relaxed)};
+            AtomicHistogram::append(out, &package, sizeof(package));
+            written++;
+        }
+        return written;
+    }
+
+private:
+    static constexpr uint32_t SLOT_BITS = 12;
+    static constexpr uint32_t SLOT_COUNT = 1u << SLOT_BITS;
+
+    struct Slot {
+        std::atomic<uint64_t> key{0};
+        std::atomic<uint64_t> counters[COUNTER_COUNT]{};
+    };
+
+    Slot slots[SLOT_COUNT];
+};
+
+class LaunchStats {
+public:
+    void record(AppKey key, LookupStatus status, const LaunchReport &report) {
+        bool targeted = status == LOOKUP_TARGETED;
+        StatsOutcome outcome = targeted ? OUTCOME_TARGETED : OUTCOME_UNTARGETED;
+        for (uint32_t phase = 0; phase < PHASE_COUNT; phase++) {
+            // Untargeted apps never get that far
+            if (!targeted && (phase == PHASE_BUILD_FIELDS || phase == PHASE_PROPERTIES)) continue;
+            histograms[phase][outcome].record(report.spanNs[phase]);
+        }
+        countPackage(key, targeted ? PackageCounters::HITS : PackageCounters::MISSES);
+        launches.fetch_add(1, std::memory_order_relaxed);
+        maybePersist();
+    }
+
+    void recordTimeout(AppKey key) {
+        countPackage(key, PackageCounters::TIMEOUTS);
+        timeouts.fetch_add(1, std::memory_order_relaxed);
+        maybePersist();
+    }
+
+private:
+    AtomicHistogram histograms[PHASE_COUNT][OUTCOME_COUNT];
+    PackageCounters packages;
+    std::atomic<uint64_t> launches{0};
+    std::atomic<uint64_t> timeouts{0};
+    std::atomic<uint64_t> droppedPackages{0};
+    std::atomic<uint64_t> lastPersistNs{0};
+    std::atomic<bool> persisting{false};
+
+    void countPackage(AppKey key, PackageCounters::Counter counter) {
+        if (!packages.add(key, counter)) droppedPackages.fetch_add(1, std::memory_order_relaxed);
+    }
+
+    void maybePersist() {
+        uint64_t now = monotonicNs();
+        uint64_t last = lastPersistNs.load(std::memory_order_relaxed);
+        if (last && now - last < STATS_PERSIST_INTERVAL_MS * 1000000ull) return;
+        if (persisting.exchange(true, std::memory_order_acquire)) return;
+        lastPersistNs.store(now, std::memory_order_relaxed);
+        persist();
+        persisting.store(false, std::memory_order_release);
+    }
+
+    void persist() const {
+        std::vector<uint8_t> out(sizeof(StatsHeader));
+        uint32_t seriesCount = 0;
+        for (uint32_t phase = 0; phase < PHASE_COUNT; phase++) {
+            for (uint32_t outcome = 0; outcome < OUTCOME_COUNT; outcome++) {
+                histograms[phase][outcome].serialize(static_cast<LaunchPhase>(phase),
+                                                     static_cast<StatsOutcome>(outcome), out);
+                seriesCount++;
+            }
+        }
+        uint32_t packageCount = packages.serialize(out);
+
+        StatsHeader header{};
+        memcpy(header.magic, STATS_MAGIC, sizeof(header.magic));
+        header.version = STATS_VERSION;
+        header.bucketCount = LogLinearBuckets::COUNT;
+        header.seriesCount = seriesCount;
+        header.packageCount = packageCount;
+        header.launches = launches.load(std::memory_order_relaxed);
+        header.timeouts = timeouts.load(std::memory_order_relaxed);
+        header.droppedPackages = droppedPackages.load(std::memory_order_relaxed);
+        header.writtenAt = static_cast<uint64_t>(time(nullptr));
+        memcpy(out.data(), &header, sizeof(header));
+
+        // Readers only ever see a complete file
+        FILE *file = fopen(STATS_PATH ".tmp", "wb");
+        if (!file) {
+            LOGE("Failed to open %s.tmp: %s", STATS_PATH, strerror(errno));
+            return;
+        }
+        bool written = fwrite(out.data(), 1, out.size(), file) == out.size();
+        written = fclose(file) == 0 && written;
+        if (!written || rename(STATS_PATH ".tmp", STATS_PATH) != 0) {
+            LOGE("Failed to write %s", STATS_PATH);
+        }
+    }
+};
+
+static LaunchStats launchStats;
+
+// The app sends its report once it is done specializing. A wedged app must
+// not pin a companion thread forever, so the wait is bounded.
+static bool receiveLaunchReport(int fd, LaunchReport &report) {
+    timeval timeout{1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_RCVTIMEO, &timeout, sizeof(timeout));
+    return xread(fd, &report, sizeof(report)) == sizeof(report);
+}
+
+// Deferred debug records follow the report; they are formatted here, off
+// the app's launch path
+static void drainAppLog(int fd, const LookupRequest &request, const LaunchReport &report) {
+    if (!report.logBytes || report.logBytes > BinaryLog::CAPACITY) return;
+
+    uint8_t records[BinaryLog::CAPACITY];
+    if (xread(fd, records, report.logBytes) != static_cast<ssize_t>(report.logBytes)) {
+        LOGE("Companion failed to read app log of uid %d", request.uid);
+        return;
+    }
+#if COPG_LOG_LEVEL >= COPG_LOG_LEVEL_DEBUG
+    BinaryLog::forEachLine(records, report.logBytes, [&](const char *line) {
+        __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, "[uid %d] %s", request.uid, line);
+    });
+    if (report.logDropped) {
+        LOGD("[uid %d] %u log records dropped", request.uid, report.logDropped);
+    }
+#endif
+}
+
+// -----------------------------------------------------------
+// Companion request handler
+// -----------------------------------------------------------
+extern "C" [[gnu::visibility("default")]]
+void copg_companion_handle(int fd) {
+    if (fd < 0) {
+        LOGE("Invalid file descriptor provided to companion");
+        return;
+    }
+
+    LookupRequest request{};
+    if (xread(fd, &request, sizeof(request)) != sizeof(request)) {
+        LOGE("Companion failed to read lookup request");
+        return;
+    }
+
+    // Checked on every request, so markers can be switched without a reboot;
+    // the app follows whatever the reply says
+    TraceMarker trace;
+    if (access(TRACE_FLAG_PATH, F_OK) == 0) trace.open();
+    ScopedTrace handlerSpan(trace, "companion");
+    int32_t flags = trace.enabled() ? LOOKUP_FLAG_TRACE : 0;
+
+    LaunchReport companionSpans{};
+    AppKey key = AppKey::fromUid(request.uid);
+    std::shared_ptr<const ConfigSnapshot> snapshot;
+    {
+        ScopedTrace span(trace, PHASE_NAMES[PHASE_SNAPSHOT]);
+        uint64_t start = monotonicNs();
+        snapshot = snapshotCache.acquire();
+        companionSpans.record(PHASE_SNAPSHOT, start);
+    }
+
+    const ConfigFragment *fragment = nullptr;
+    const CompiledProfile *profile = nullptr;
+    {
+        ScopedTrace span(trace, PHASE_NAMES[PHASE_LOOKUP]);
+        uint64_t start = monotonicNs();
+        const AppBinding *app = key.isApplication() ? snapshot->find(key) : nullptr;
+        if (app && snapshot->spoofsProcess(*app, request)) {
+            fragment = snapshot->fragments[app->fragment].get();
+            profile = &fragment->profiles[app->profile];
+        }
+        companionSpans.record(PHASE_LOOKUP, start);
+    }
+
+    LookupStatus status = profile ? LOOKUP_TARGETED : LOOKUP_UNTARGETED;
+    if (!profile) {
+        int32_t untargeted = LOOKUP_UNTARGETED | flags;
+        if (xwrite(fd, &untargeted, sizeof(untargeted)) != sizeof(untargeted)) {
+            LOGE("Companion failed to send lookup status");
+            return;
+        }
+    } else {
+        // Record, properties and SoC entries leave in a single write
+        char message[sizeof(LookupReply) + PROPERTY_TAIL_MAX + SOC_TAIL_MAX];
+        LookupReply reply{LOOKUP_TARGETED | flags, {}};
+        fragment->materialize(*profile, reply.profile);
+        memcpy(message, &reply, sizeof(reply));
+        fragment->writeTail(*profile, message + sizeof(reply));
+        auto size = static_cast<ssize_t>(sizeof(reply) + reply.profile.propertyBytes + reply.profile.socBytes);
+        if (xwrite(fd, message, size) != size) {
+            LOGE("Companion failed to send device configuration");
+            return;
+        }
+        LOGD("Companion matched uid %d (user %u, app %u)", request.uid, key.userId, key.appId);
+    }
+
+    // The snapshot must not outlive a reload just because an app is slow
+    snapshot.reset();
+
+    LaunchReport report{};
+    bool received;
+    {
+        ScopedTrace span(trace, "await_report");
+        received = receiveLaunchReport(fd, report);
+    }
+    if (!received) {
+        LOGD("No launch report from uid %d", request.uid);
+        if (key.isApplication()) launchStats.recordTimeout(key);
+        return;
+    }
+    report.spanNs[PHASE_SNAPSHOT] = companionSpans.spanNs[PHASE_SNAPSHOT];
+    report.spanNs[PHASE_LOOKUP] = companionSpans.spanNs[PHASE_LOOKUP];
+    if (key.isApplication()) launchStats.record(key, status, report);
+
+    ScopedTrace span(trace, "drain_log");
+    drainAppLog(fd, request, report);
+}
@@ -0,0 +1,157 @@
+// copgstat: prints the launch statistics persisted by the companion
+//
+// Usage: copgstat [--openmetrics] [--stats FILE] [--packages FILE]
+//
+// The default output lists per-phase latency percentiles and per-package
+// hit/miss/timeout counters. --openmetrics prints the same data as
+// OpenMetrics text for a scraper.
+
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "common.hpp"
+#include "protocol.hpp"
+#include "stats.hpp"
+
+static constexpr double PERCENTILES[] = {50, 90, 99, 99.9};
+
+static bool readAll(const char *path, std::vector<uint8_t> &out) {
+    FILE *file = fopen(path, "rb");
+    if (!file) return false;
+    uint8_t buffer[16384];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        out.insert(out.end(), buffer, buffer + n);
+    }
+    bool ok = !ferror(file);
+    fclose(file);
+    return ok;
+}
+
+// appId -> package name, from packages.list when it is readable
+static std::unordered_map<uint32_t, std::string> loadPackageNames(const char *path) {
+    std::unordered_map<uint32_t, std::string> names;
+    FILE *file = fopen(path, "r");
+    if (!file) return names;
+    char line[1024];
+    while (fgets(line, sizeof(line), file)) {
+        char name[512];
+        unsigned appId;
+        if (sscanf(line, "%511s %u", name, &appId) == 2) names.emplace(appId, name);
+    }
+    fclose(file);
+    return names;
+}
+
+static std::string packageLabel(const std::unordered_map<uint32_t, std::string> &names, uint32_t appId) {
+    auto it = names.find(appId);
+    return it != names.end() ? it->second : "app" + std::to_string(appId);
+}
+
+static void printTable(const StatsSnapshot &stats, const std::unordered_map<uint32_t, std::string> &names) {
+    printf("launches %llu, timeouts %llu, dropped packages %llu\n\n",
+           static_cast<unsigned long long>(stats.header.launches),
+           static_cast<unsigned long long>(stats.header.timeouts),
+           static_cast<unsigned long long>(stats.header.droppedPackages));
+
+    printf("%-13s %-11s %9s %10s %10s %10s %10s %10s\n",
+           "phase", "outcome", "count", "mean_us", "p50_us", "p90_us", "p99_us", "p99.9_us");
+    for (const auto &series : stats.series) {
+        if (!series.info.count || series.info.phase >= PHASE_COUNT || series.info.outcome >= OUTCOME_COUNT) continue;
+        printf("%-13s %-11s %9llu %10.1f", PHASE_NAMES[series.info.phase], OUTCOME_NAMES[series.info.outcome],
+               static_cast<unsigned long long>(series.info.count),
+               static_cast<double>(series.info.sumNs) / series.info.count / 1e3);
+        for (double p : PERCENTILES) printf(" %10.1f", series.percentile(p) / 1e3);
+        printf("\n");
+    }
+
+    printf("\n%-6s %-48s %9s %9s %9s\n", "user", "package", "hits", "misses", "timeouts");
+    for (const auto &package : stats.packages) {
+        printf("%-6u %-48s %9llu %9llu %9llu\n", package.userId, packageLabel(names, package.appId).c_str(),
+               static_cast<unsigned long long>(package.hits),
+               static_cast<unsigned long long>(package.misses),
+               static_cast<unsigned long long>(package.timeouts));
+    }
+}
+
+static void printOpenMetrics(const StatsSnapshot &stats, const std::unordered_map<uint32_t, std::string> &names) {
+    printf("# TYPE copg_phase_duration_seconds summary\n");
+    printf("# UNIT copg_phase_duration_seconds seconds\n");
+    printf("# HELP copg_phase_duration_seconds Time spent per launch phase.\n");
+    for (const auto &series : stats.series) {
+        if (!series.info.count || series.info.phase >= PHASE_COUNT || series.info.outcome >= OUTCOME_COUNT) continue;
+        const char *phase = PHASE_NAMES[series.info.phase];
+        const char *outcome = OUTCOME_NAMES[series.info.outcome];
+        for (double p : PERCENTILES) {
+            printf("copg_phase_duration_seconds{phase=\"%s\",outcome=\"%s\",quantile=\"%g\"} %.9f\n",
+                   phase, outcome, p / 100, series.percentile(p) / 1e9);
+        }
+        printf("copg_phase_duration_seconds_sum{phase=\"%s\",outcome=\"%s\"} %.9f\n",
+               phase, outcome, series.info.sumNs / 1e9);
+        printf("copg_phase_duration_seconds_count{phase=\"%s\",outcome=\"%s\"} %llu\n",
+               phase, outcome, static_cast<unsigned long long>(series.info.count));
+    }
+
+    printf("# TYPE copg_launch_timeouts counter\n");
+    printf("# HELP copg_launch_timeouts Lookups answered but never reported back.\n");
+    printf("copg_launch_timeouts_total %llu\n", static_cast<unsigned long long>(stats.header.timeouts));
+
+    printf("# TYPE copg_package_launches counter\n");
+    printf("# HELP copg_package_launches Launches per package and result.\n");
+    for (const auto &package : stats.packages) {
+        std::string name = packageLabel(names, package.appId);
+        const std::pair<const char *, uint64_t> results[] = {
+            {"hit", package.hits}, {"miss", package.misses}, {"timeout", package.timeouts}};
+        for (const auto &[result, count] : results) {
+            if (!count) continue;
+            printf("copg_package_launches_total{user=\"%u\",package=\"%s\",result=\"%s\"} %llu\n",
+                   package.userId, name.c_str(), result, static_cast<unsigned long long>(count));
+        }
+    }
+    printf("# EOF\n");
+}
+
+int main(int argc, char **argv) {
+    const char *statsPath = STATS_PATH;
+    const char *packagesPath = PACKAGES_LIST_PATH;
+    bool openMetrics = false;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--openmetrics")) {
+            openMetrics = true;
+        } else if (!strcmp(argv[i], "--stats") && i + 1 < argc) {
+            statsPath = argv[++i];
+        } else if (!strcmp(argv[i], "--packages") && i + 1 < argc) {
+            packagesPath = argv[++i];
+        } else {
+            fprintf(stderr, "usage: %s [--openmetrics] [--stats FILE] [--packages FILE]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    std::vector<uint8_t> data;
+    if (!readAll(statsPath, data)) {
+        fprintf(stderr, "cannot read %s: %s\n", statsPath, strerror(errno));
+        return 1;
+    }
+    StatsSnapshot stats;
+    if (!stats.parse(data.data(), data.size())) {
+        fprintf(stderr, "%s is not a stats file of this version\n", statsPath);
+        return 1;
+    }
+
+    std::sort(stats.packages.begin(), stats.packages.end(), [](const auto &a, const auto &b) {
+        return a.userId != b.userId ? a.userId < b.userId : a.appId < b.appId;
+    });
+    auto names = loadPackageNames(packagesPath);
+    if (openMetrics) {
+        printOpenMetrics(stats, names);
+    } else {
+        printTable(stats, names);
+    }
+    return 0;
+}
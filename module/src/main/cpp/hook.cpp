@@ -1,145 +1,74 @@
-#include <android/log.h>
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <link.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
 #include <unistd.h>
+#include <climits>
+#include <cstdarg>
+#include <cstddef>
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
-#include <vector>
-#include <string>
 
 #include "zygisk.hpp"
-
-#define JSON_NOEXCEPTION 1
-#define JSON_NO_IO 1
-#include "json.hpp"
-
-#define LOG_TAG "CombinedSpoofModule"
-#define LOGD(...) __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, __VA_ARGS__)
-#define LOGE(...) __android_log_print(ANDROID_LOG_ERROR, LOG_TAG, __VA_ARGS__)
-
-#define CONFIG_PATH "/data/adb/modules/COPG/config.json"
+#include "common.hpp"
+#include "protocol.hpp"
+#include "binlog.hpp"
+#include "builtin.hpp"
+#include "trace.hpp"
 
 #include <sys/system_properties.h>
 
-// -----------------------------------------------------------
-// Safe read/write functions
-// -----------------------------------------------------------
-static ssize_t xread(int fd, void *buffer, size_t count) {
-    ssize_t total = 0;
-    char *buf = (char *) buffer;
-    while (count > 0) {
-        ssize_t ret = TEMP_FAILURE_RETRY(read(fd, buf, count));
-        if (ret < 0) return -1;
-        buf += ret;
-        total += ret;
-        count -= ret;
-    }
-    return total;
-}
+// Debug records of this process, shipped to the companion with the report
+static BinaryLog binaryLog;
 
-static ssize_t xwrite(int fd, const void *buffer, size_t count) {
-    ssize_t total = 0;
-    char *buf = (char *) buffer;
-    while (count > 0) {
-        ssize_t ret = TEMP_FAILURE_RETRY(write(fd, buf, count));
-        if (ret < 0) return -1;
-        buf += ret;
-        total += ret;
-        count -= ret;
-    }
-    return total;
+// Paths that never reach the companion write their records out here
+static void flushLogLocally() {
+#if COPG_LOG_LEVEL >= COPG_LOG_LEVEL_DEBUG
+    BinaryLog::forEachLine(binaryLog.data(), binaryLog.size(), [](const char *line) {
+        __android_log_print(ANDROID_LOG_DEBUG, LOG_TAG, "%s", line);
+    });
+    binaryLog.reset();
+#endif
 }
 
-// -----------------------------------------------------------
-// Device configuration structure
-// -----------------------------------------------------------
-struct DeviceConfig {
-    std::string brand;
-    std::string device;
-    std::string manufacturer;
-    std::string model;
-    std::string fingerprint;
-    std::string product;
-    
-    // Additional properties for comprehensive spoofing
-    std::string board;
-    std::string hardware;
-    std::string serial;
-    
-    bool isEmpty() const {
-        return brand.empty() && device.empty() && manufacturer.empty() && 
-               model.empty() && fingerprint.empty() && product.empty();
-    }
-    
-    void clear() {
-        brand.clear();
-        device.clear();
-        manufacturer.clear();
-        model.clear();
-        fingerprint.clear();
-        product.clear();
-        board.clear();
-        hardware.clear();
-        serial.clear();
-    }
-};
-
 // -----------------------------------------------------------
 // System property spoofing utilities
 // -----------------------------------------------------------
 class PropertySpoofManager {
 public:
-    static void spoofProperty(const std::string& propName, const std::string& value) {
-        if (value.empty()) return;
+    static void spoofProperty(const char* propName, const char* value) {
+        if (!value[0]) return;
         
-        int result = __system_property_set(propName.c_str(), value.c_str());
+        int result = __system_property_set(propName, value);
         if (result == 0) {
-            LOGD("Successfully set property '%s' = '%s'", propName.c_str(), value.c_str());
+            BLOGD(binaryLog, MSG_PROPERTY_SET, propName, value);
         } else {
             LOGE("Failed to set property '%s' = '%s' (error: %d)", 
-                 propName.c_str(), value.c_str(), result);
+                 propName, value, result);
         }
     }
     
-    static void spoofComprehensiveProperties(const DeviceConfig& config) {
-        LOGD("Initiating comprehensive property spoofing for: %s", config.model.c_str());
-        
-        // Core product properties
-        spoofProperty("ro.product.brand", config.brand);
-        spoofProperty("ro.product.device", config.device);
-        spoofProperty("ro.product.manufacturer", config.manufacturer);
-        spoofProperty("ro.product.model", config.model);
-        spoofProperty("ro.product.name", config.product);
-        
-        // Build properties
-        spoofProperty("ro.build.fingerprint", config.fingerprint);
-        spoofProperty("ro.build.product", config.product);
-        
-        // Additional hardware properties
-        if (!config.board.empty()) {
-            spoofProperty("ro.product.board", config.board);
-        }
-        if (!config.hardware.empty()) {
-            spoofProperty("ro.hardware", config.hardware);
-        }
-        if (!config.serial.empty()) {
-            spoofProperty("ro.serialno", config.serial);
+    // The companion sends every assignment of the profile, the standard
+    // ro.product.* set included, as name and value pairs
+    static void applyProperties(const DeviceConfig& config, const char* data, uint32_t bytes, uint32_t count) {
+        BLOGD(binaryLog, MSG_PROPERTIES_BEGIN, count, config.model);
+
+        const char* cursor = data;
+        const char* end = data + bytes;
+        for (uint32_t i = 0; i < count; i++) {
+            auto nameEnd = static_cast<const char*>(memchr(cursor, '\0', end - cursor));
+            if (!nameEnd) break;
+            auto valueEnd = static_cast<const char*>(memchr(nameEnd + 1, '\0', end - nameEnd - 1));
+            if (!valueEnd) break;
+            spoofProperty(cursor, nameEnd + 1);
+            cursor = valueEnd + 1;
         }
-        
-        // Vendor-specific properties for comprehensive spoofing
-        spoofProperty("ro.product.vendor.brand", config.brand);
-        spoofProperty("ro.product.vendor.device", config.device);
-        spoofProperty("ro.product.vendor.manufacturer", config.manufacturer);
-        spoofProperty("ro.product.vendor.model", config.model);
-        spoofProperty("ro.product.vendor.name", config.product);
-        
-        // System properties
-        spoofProperty("ro.product.system.brand", config.brand);
-        spoofProperty("ro.product.system.device", config.device);
-        spoofProperty("ro.product.system.manufacturer", config.manufacturer);
-        spoofProperty("ro.product.system.model", config.model);
-        spoofProperty("ro.product.system.name", config.product);
-        
-        LOGD("Property spoofing completed successfully");
+
+        BLOGD(binaryLog, MSG_PROPERTIES_DONE);
     }
 };
 
@@ -188,7 +117,7 @@ public:
             return false;
         }
         
-        LOGD("Updating Build fields with device configuration");
+        BLOGD(binaryLog, MSG_BUILD_FIELDS_UPDATING);
         
         setBuildField("BRAND", config.brand);
         setBuildField("DEVICE", config.device);
@@ -202,15 +131,15 @@ public:
         setBuildField("HARDWARE", config.hardware);
         setBuildField("SERIAL", config.serial);
         
-        LOGD("Build field updates completed");
+        BLOGD(binaryLog, MSG_BUILD_FIELDS_UPDATED);
         return true;
     }
 
 private:
-    void setBuildField(const char* fieldName, const std::string& value) {
-        if (!initialized || value.empty()) {
-            if (value.empty()) {
-                LOGD("Skipping empty field: %s", fieldName);
+    void setBuildField(const char* fieldName, const char* value) {
+        if (!initialized || !value[0]) {
+            if (!value[0]) {
+                BLOGD(binaryLog, MSG_FIELD_SKIPPED, fieldName);
             }
             return;
         }
@@ -221,13 +150,13 @@ private:
             fieldID = env->GetStaticFieldID(versionClass, fieldName, "Ljava/lang/String;");
             if (env->ExceptionCheck()) {
                 env->ExceptionClear();
-                LOGD("Field '%s' not found in Build or VERSION classes", fieldName);
+                BLOGD(binaryLog, MSG_FIELD_NOT_FOUND, fieldName);
                 return;
             }
         }
 
         if (fieldID != nullptr) {
-            jstring jValue = env->NewStringUTF(value.c_str());
+            jstring jValue = env->NewStringUTF(value);
             if (!jValue) {
                 LOGE("Failed to create jstring for field '%s'", fieldName);
                 return;
@@ -241,54 +170,643 @@ private:
                 return;
             }
             
-            LOGD("Successfully set Java field '%s' = '%s'", fieldName, value.c_str());
+            BLOGD(binaryLog, MSG_FIELD_SET, fieldName, value);
             env->DeleteLocalRef(jValue);
         }
     }
 };
 
+// -----------------------------------------------------------
+// SoC file virtualisation
+//
+// Games pick frame-rate tiers from the "Hardware" line of /proc/cpuinfo and
+// from /sys/devices/soc0/*, which no property reaches. For a profile with
+// SOC entries the contents are built once into this cache, and the hooked
+// opens below hand out a sealed memfd holding the content of a virtual
+// path: reads, seeks and fstat then work on a real fd, so read itself needs
+// no hook, and nothing is ever written to a filesystem.
+// -----------------------------------------------------------
+class SocFileCache {
+public:
+    static constexpr uint32_t FILE_MAX = 16;
+    static constexpr size_t CONTENT_MAX = 65536;
+
+    // Builds the files from count name and value pairs, bytes in total
+    void build(const char* data, uint32_t bytes, uint32_t count) {
+        const char* cursor = data;
+        const char* end = data + bytes;
+        for (uint32_t i = 0; i < count; i++) {
+            auto nameEnd = static_cast<const char*>(memchr(cursor, '\0', end - cursor));
+            if (!nameEnd) break;
+            auto valueEnd = static_cast<const char*>(memchr(nameEnd + 1, '\0', end - nameEnd - 1));
+            if (!valueEnd) break;
+            if (!strcmp(cursor, SOC_CPUINFO_ENTRY)) {
+                addCpuinfo(nameEnd + 1);
+            } else {
+                addSysfsFile(cursor, nameEnd + 1);
+            }
+            cursor = valueEnd + 1;
+        }
+    }
+
+    uint32_t size() const { return fileCount; }
+
+    // A memfd holding the content of path, or -1 if path is not served from
+    // here or the memfd cannot be made; writers always get the real file
+    int open(const char* path, int flags) const {
+        if (!path || path[0] != '/' || (flags & O_ACCMODE) != O_RDONLY) return -1;
+        const File* file = find(path);
+        if (!file) return -1;
+
+        unsigned memfdFlags = MFD_ALLOW_SEALING | ((flags & O_CLOEXEC) ? MFD_CLOEXEC : 0);
+        int fd = static_cast<int>(syscall(__NR_memfd_create, "copg-soc", memfdFlags));
+        if (fd < 0) return -1;
+        if (xwrite(fd, content + file->offset, file->length) != static_cast<ssize_t>(file->length) ||
+            lseek(fd, 0, SEEK_SET) != 0) {
+            close(fd);
+            return -1;
+        }
+        fcntl(fd, F_ADD_SEALS, F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL);
+        return fd;
+    }
+
+private:
+    static constexpr char CPUINFO_PATH[] = "/proc/cpuinfo";
+    static constexpr char SOC_BUS_DIR[] = "/sys/bus/soc/devices/soc0/";  // Symlinks to SOC_SYSFS_DIR
+
+    struct File {
+        char path[sizeof(SOC_SYSFS_DIR) + SOC_NAME_MAX];
+        uint32_t offset;  // Into content
+        uint32_t length;
+    };
+
+    File files[FILE_MAX];
+    uint32_t fileCount = 0;
+    char content[CONTENT_MAX];
+    size_t used = 0;
+
+    const File* find(const char* path) const {
+        const char* busName = strncmp(path, SOC_BUS_DIR, sizeof(SOC_BUS_DIR) - 1) ? nullptr
+                                                                                   : path + sizeof(SOC_BUS_DIR) - 1;
+        for (uint32_t i = 0; i < fileCount; i++) {
+            const char* filePath = files[i].path;
+            if (!strcmp(path, filePath)) return &files[i];
+            if (busName && !strncmp(filePath, SOC_SYSFS_DIR, sizeof(SOC_SYSFS_DIR) - 1) &&
+                !strcmp(filePath + sizeof(SOC_SYSFS_DIR) - 1, busName)) {
+                return &files[i];
+            }
+        }
+        return nullptr;
+    }
+
+    // Sysfs attributes are one line each
+    void addSysfsFile(const char* name, const char* value) {
+        size_t length = strlen(value);
+        if (fileCount == FILE_MAX || strlen(name) >= SOC_NAME_MAX || used + length + 1 > CONTENT_MAX) {
+            LOGE("No room to serve SoC file %s", name);
+            return;
+        }
+        File& file = files[fileCount++];
+        snprintf(file.path, sizeof(file.path), "%s%s", SOC_SYSFS_DIR, name);
+        file.offset = static_cast<uint32_t>(used);
+        file.length = static_cast<uint32_t>(length + 1);
+        memcpy(content + used, value, length);
+        content[used + length] = '\n';
+        used += length + 1;
+    }
+
+    // The real cpuinfo with its Hardware line, if any, replaced by ours at
+    // the end, where arm kernels print it
+    void addCpuinfo(const char* hardware) {
+        if (fileCount == FILE_MAX) return;
+        int fd = ::open(CPUINFO_PATH, O_RDONLY | O_CLOEXEC);
+        if (fd < 0) {
+            LOGE("Failed to read %s", CPUINFO_PATH);
+            return;
+        }
+        size_t room = CONTENT_MAX - used;
+        ssize_t bytes = xread(fd, content + used, room);
+        close(fd);
+
+        size_t hardwareLength = strlen(hardware);
+        if (bytes < 0 || static_cast<size_t>(bytes) == room) {
+            LOGE("%s does not fit the SoC file cache", CPUINFO_PATH);
+            return;
+        }
+
+        // Drop Hardware lines in place
+        char* begin = content + used;
+        char* out = begin;
+        const char* end = begin + bytes;
+        for (const char* line = begin; line < end;) {
+            auto newline = static_cast<const char*>(memchr(line, '\n', end - line));
+            const char* next = newline ? newline + 1 : end;
+            if (!isHardwareLine(line, next)) {
+                memmove(out, line, next - line);
+                out += next - line;
+            }
+            line = next;
+        }
+        if (out > begin && out[-1] != '\n') *out++ = '\n';
+
+        static constexpr char KEY[] = "Hardware\t: ";
+        if (static_cast<size_t>(out - content) + sizeof(KEY) + hardwareLength > CONTENT_MAX) {
+            LOGE("%s does not fit the SoC file cache", CPUINFO_PATH);
+            return;
+        }
+        memcpy(out, KEY, sizeof(KEY) - 1);
+        out += sizeof(KEY) - 1;
+        memcpy(out, hardware, hardwareLength);
+        out += hardwareLength;
+        *out++ = '\n';
+
+        File& file = files[fileCount++];
+        strcpy(file.path, CPUINFO_PATH);
+        file.offset = static_cast<uint32_t>(used);
+        file.length = static_cast<uint32_t>(out - begin);
+        used += file.length;
+    }
+
+    static bool isHardwareLine(const char* line, const char* end) {
+        static constexpr char KEY[] = "Hardware";
+        if (static_cast<size_t>(end - line) < sizeof(KEY) || strncmp(line, KEY, sizeof(KEY) - 1) != 0) return false;
+        for (line += sizeof(KEY) - 1; line < end && (*line == ' ' || *line == '\t'); line++) {}
+        return line < end && *line == ':';
+    }
+};
+
+// Only ever filled in an app whose profile has SOC entries
+static SocFileCache socFiles;
+
+// -----------------------------------------------------------
+// File open hooks
+//
+// Registered through Zygisk's PLT hooks for every library mapped when the
+// app specializes, so Java file reads through libcore and libopenjdk and
+// native ones from system libraries are covered; libraries loaded later
+// get them when their load returns, see below.
+// -----------------------------------------------------------
+using OpenFn = int (*)(const char*, int, ...);
+using OpenatFn = int (*)(int, const char*, int, ...);
+using FortifiedOpenFn = int (*)(const char*, int);
+using FortifiedOpenatFn = int (*)(int, const char*, int);
+using FopenFn = FILE* (*)(const char*, const char*);
+
+static OpenFn realOpen, realOpen64;
+static OpenatFn realOpenat, realOpenat64;
+static FortifiedOpenFn realFortifiedOpen;
+static FortifiedOpenatFn realFortifiedOpenat;
+static FopenFn realFopen, realFopen64;
+
+// The mode argument is only passed when the flags can create a file
+static mode_t modeArgument(int flags, va_list args) {
+    return (flags & O_CREAT) || (flags & O_TMPFILE) == O_TMPFILE ? static_cast<mode_t>(va_arg(args, int)) : 0;
+}
+
+template <OpenFn* Real>
+static int openHook(const char* path, int flags, ...) {
+    va_list args;
+    va_start(args, flags);
+    mode_t mode = modeArgument(flags, args);
+    va_end(args);
+    int fd = socFiles.open(path, flags);
+    return fd >= 0 ? fd : (*Real)(path, flags, mode);
+}
+
+template <OpenatFn* Real>
+static int openatHook(int dirFd, const char* path, int flags, ...) {
+    va_list args;
+    va_start(args, flags);
+    mode_t mode = modeArgument(flags, args);
+    va_end(args);
+    int fd = socFiles.open(path, flags);
+    return fd >= 0 ? fd : (*Real)(dirFd, path, flags, mode);
+}
+
+static int fortifiedOpenHook(const char* path, int flags) {
+    int fd = socFiles.open(path, flags);
+    return fd >= 0 ? fd : realFortifiedOpen(path, flags);
+}
+
+static int fortifiedOpenatHook(int dirFd, const char* path, int flags) {
+    int fd = socFiles.open(path, flags);
+    return fd >= 0 ? fd : realFortifiedOpenat(dirFd, path, flags);
+}
+
+// fopen reaches open inside libc, past any PLT, so it is hooked itself
+template <FopenFn* Real>
+static FILE* fopenHook(const char* path, const char* mode) {
+    if (mode && mode[0] == 'r' && !strchr(mode, '+')) {
+        int fd = socFiles.open(path, O_RDONLY | (strchr(mode, 'e') ? O_CLOEXEC : 0));
+        if (fd >= 0) {
+            if (FILE* file = fdopen(fd, mode)) return file;
+            close(fd);
+        }
+    }
+    return (*Real)(path, mode);
+}
+
+struct PltHook {
+    const char* symbol;
+    void* replacement;
+    void** original;
+};
+
+static const PltHook OPEN_HOOKS[] = {
+    {"open", reinterpret_cast<void*>(openHook<&realOpen>), reinterpret_cast<void**>(&realOpen)},
+    {"open64", reinterpret_cast<void*>(openHook<&realOpen64>), reinterpret_cast<void**>(&realOpen64)},
+    {"openat", reinterpret_cast<void*>(openatHook<&realOpenat>), reinterpret_cast<void**>(&realOpenat)},
+    {"openat64", reinterpret_cast<void*>(openatHook<&realOpenat64>), reinterpret_cast<void**>(&realOpenat64)},
+    {"__open_2", reinterpret_cast<void*>(fortifiedOpenHook), reinterpret_cast<void**>(&realFortifiedOpen)},
+    {"__openat_2", reinterpret_cast<void*>(fortifiedOpenatHook), reinterpret_cast<void**>(&realFortifiedOpenat)},
+    {"fopen", reinterpret_cast<void*>(fopenHook<&realFopen>), reinterpret_cast<void**>(&realFopen)},
+    {"fopen64", reinterpret_cast<void*>(fopenHook<&realFopen64>), reinterpret_cast<void**>(&realFopen64)},
+};
+
+// -----------------------------------------------------------
+// GL string spoofing
+//
+// Games gate their high frame-rate modes on GL_RENDERER and GL_VENDOR. For
+// a profile that sets either, calls to libGLESv2's glGetString are hooked
+// alongside the file opens and answered from fixed buffers, so a call never
+// allocates; every other name still reaches the driver.
+// -----------------------------------------------------------
+class GlStrings {
+public:
+    // From GLES2/gl2.h, which the module has no other use for
+    static constexpr unsigned VENDOR = 0x1F00;
+    static constexpr unsigned RENDERER = 0x1F01;
+
+    void assign(const DeviceConfig& config) {
+        strcpy(renderer, config.glRenderer);
+        strcpy(vendor, config.glVendor);
+    }
+
+    bool empty() const { return !renderer[0] && !vendor[0]; }
+
+    // The profile's string for name, or nullptr to ask the driver
+    const unsigned char* find(unsigned name) const {
+        const char* value = name == RENDERER ? renderer : name == VENDOR ? vendor : nullptr;
+        return value && value[0] ? reinterpret_cast<const unsigned char*>(value) : nullptr;
+    }
+
+private:
+    DeviceConfig::Field renderer;
+    DeviceConfig::Field vendor;
+};
+
+static GlStrings glStrings;
+
+using GetStringFn = const unsigned char* (*)(unsigned);
+
+static GetStringFn realGlGetString;
+
+static const unsigned char* glGetStringHook(unsigned name) {
+    const unsigned char* value = glStrings.find(name);
+    return value ? value : realGlGetString(name);
+}
+
+static const PltHook GL_HOOKS[] = {
+    {"glGetString", reinterpret_cast<void*>(glGetStringHook), reinterpret_cast<void**>(&realGlGetString)},
+};
+
+// -----------------------------------------------------------
+// Libraries loaded later
+//
+// Game engines are mostly loaded after postAppSpecialize, each with a PLT
+// of its own. dlopen, android_dlopen_ext and dlclose are hooked next to the
+// open and GL hooks, and once a load returns, every library it mapped,
+// dependencies and libraries read straight from an APK included, gets the
+// same hooks. Libraries are told apart by load base, so one closed and
+// loaded again is hooked again.
+//
+// The linker picks the namespace a load searches by the caller's address,
+// so the app's return address is passed on through the linker's own entry
+// points where they are exported.
+// -----------------------------------------------------------
+
+// Load bases of the libraries handed to Zygisk, sorted; a rescan keeps the
+// bases it sees again and drops the rest, which were unloaded
+class HookedLibraries {
+public:
+    void beginScan() { nextCount = 0; }
+
+    // True if base was not loaded at the last scan
+    bool visit(uintptr_t base) {
+        if (nextCount < CAPACITY) {
+            next()[nextCount++] = base;
+        } else if (!full) {
+            full = true;
+            LOGE("No room to track hooked libraries, rehooking the rest on every load");
+        }
+        return !bsearch(&base, bases[current], count, sizeof(uintptr_t), compare);
+    }
+
+    void endScan() {
+        qsort(next(), nextCount, sizeof(uintptr_t), compare);
+        current ^= 1;
+        count = nextCount;
+    }
+
+private:
+    static constexpr uint32_t CAPACITY = 2048;
+
+    static int compare(const void* a, const void* b) {
+        uintptr_t left = *static_cast<const uintptr_t*>(a);
+        uintptr_t right = *static_cast<const uintptr_t*>(b);
+        return left < right ? -1 : left > right;
+    }
+
+    uintptr_t* next() { return bases[current ^ 1]; }
+
+    uintptr_t bases[2][CAPACITY];
+    uint32_t current = 0;
+    uint32_t count = 0;
+    uint32_t nextCount = 0;
+    bool full = false;
+};
+
+static HookedLibraries hookedLibraries;
+
+static uint32_t registerPltHooks(zygisk::Api* api, bool opens, bool gl);
+
+// Zygisk API and hook selection of postAppSpecialize, for the loads after it
+class LateLoads {
+public:
+    using LoaderDlopenFn = void* (*)(const char*, int, const void*);
+    using LoaderAndroidDlopenExtFn = void* (*)(const char*, int, const void*, const void*);
+
+    LoaderDlopenFn loaderDlopen = nullptr;
+    LoaderAndroidDlopenExtFn loaderAndroidDlopenExt = nullptr;
+
+    void enable(zygisk::Api* api, bool opens, bool gl) {
+        this->api = api;
+        this->opens = opens;
+        this->gl = gl;
+        loaderDlopen = reinterpret_cast<LoaderDlopenFn>(dlsym(RTLD_DEFAULT, "__loader_dlopen"));
+        loaderAndroidDlopenExt =
+            reinterpret_cast<LoaderAndroidDlopenExtFn>(dlsym(RTLD_DEFAULT, "__loader_android_dlopen_ext"));
+    }
+
+    // Loads and unloads may race on app threads; registration and commit
+    // are one step. A dlopen that only hands back a loaded library leaves
+    // the loader's counts alone and returns without the lock.
+    void rescan(const char* filename) {
+        if (!api || !changed()) return;
+        pthread_mutex_lock(&lock);
+        Generation now = generation();
+        uint32_t libraries = registerPltHooks(api, opens, gl);
+        bool committed = !libraries || api->pltHookCommit();
+        if (committed && now.known) {
+            __atomic_store_n(&scanned.adds, now.adds, __ATOMIC_RELEASE);
+            __atomic_store_n(&scanned.subs, now.subs, __ATOMIC_RELEASE);
+        }
+        pthread_mutex_unlock(&lock);
+        if (!committed) {
+            LOGE("Failed to commit PLT hooks for %s", filename ? filename : "(null)");
+        } else if (libraries) {
+            LOGD("Installed PLT hooks in %u libraries loaded with %s", libraries, filename ? filename : "(null)");
+        }
+    }
+
+private:
+    // dl_iterate_phdr's counts of loads and unloads, where the loader keeps
+    // them (Android 11 and later)
+    struct Generation {
+        unsigned long long adds;
+        unsigned long long subs;
+        bool known;
+    };
+
+    static Generation generation() {
+        Generation now{};
+        dl_iterate_phdr([](dl_phdr_info* info, size_t size, void* data) -> int {
+            if (size >= offsetof(dl_phdr_info, dlpi_subs) + sizeof(info->dlpi_subs)) {
+                *static_cast<Generation*>(data) = {info->dlpi_adds, info->dlpi_subs, true};
+            }
+            return 1;
+        }, &now);
+        return now;
+    }
+
+    // Counts are only published once a scan is committed, so a load that
+    // matches them has its hooks in place
+    bool changed() const {
+        Generation now = generation();
+        return !now.known || now.adds != __atomic_load_n(&scanned.adds, __ATOMIC_ACQUIRE) ||
+               now.subs != __atomic_load_n(&scanned.subs, __ATOMIC_ACQUIRE);
+    }
+
+    zygisk::Api* api = nullptr;
+    bool opens = false;
+    bool gl = false;
+    Generation scanned{};
+    pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+};
+
+static LateLoads lateLoads;
+
+using DlopenFn = void* (*)(const char*, int);
+using AndroidDlopenExtFn = void* (*)(const char*, int, const void*);  // android_dlextinfo, passed through
+using DlcloseFn = int (*)(void*);
+
+static DlopenFn realDlopen;
+static AndroidDlopenExtFn realAndroidDlopenExt;
+static DlcloseFn realDlclose;
+
+static void* dlopenHook(const char* filename, int flags) {
+    const void* caller = __builtin_return_address(0);
+    void* handle = lateLoads.loaderDlopen ? lateLoads.loaderDlopen(filename, flags, caller)
+                                          : realDlopen(filename, flags);
+    if (handle) lateLoads.rescan(filename);
+    return handle;
+}
+
+static void* androidDlopenExtHook(const char* filename, int flags, const void* extinfo) {
+    const void* caller = __builtin_return_address(0);
+    void* handle = lateLoads.loaderAndroidDlopenExt
+                       ? lateLoads.loaderAndroidDlopenExt(filename, flags, extinfo, caller)
+                       : realAndroidDlopenExt(filename, flags, extinfo);
+    if (handle) lateLoads.rescan(filename);
+    return handle;
+}
+
+// Forgets the bases an unload freed before another library can take one
+static int dlcloseHook(void* handle) {
+    int result = realDlclose(handle);
+    if (result == 0) lateLoads.rescan(nullptr);
+    return result;
+}
+
+static const PltHook DLOPEN_HOOKS[] = {
+    {"dlopen", reinterpret_cast<void*>(dlopenHook), reinterpret_cast<void**>(&realDlopen)},
+    {"android_dlopen_ext", reinterpret_cast<void*>(androidDlopenExtHook),
+     reinterpret_cast<void**>(&realAndroidDlopenExt)},
+    {"dlclose", reinterpret_cast<void*>(dlcloseHook), reinterpret_cast<void**>(&realDlclose)},
+};
+
+// Registers the open and GL hooks, as selected, and the load hooks for
+// every library loaded since the last call but the executable and this
+// one, and returns how many there were; the caller commits
+static uint32_t registerPltHooks(zygisk::Api* api, bool opens, bool gl) {
+    struct Scan {
+        zygisk::Api* api;
+        bool opens;
+        bool gl;
+        const char* self;
+        bool executable;
+        uint32_t libraries;
+    } scan{api, opens, gl, nullptr, true, 0};
+    Dl_info info{};
+    if (!dladdr(reinterpret_cast<void*>(&registerPltHooks), &info) || !info.dli_fname) {
+        LOGE("Failed to locate the module library");
+        return 0;
+    }
+    scan.self = info.dli_fname;
+
+    hookedLibraries.beginScan();
+    dl_iterate_phdr([](dl_phdr_info* library, size_t, void* data) -> int {
+        auto& scan = *static_cast<Scan*>(data);
+        // The executable always comes first
+        bool executable = scan.executable;
+        scan.executable = false;
+        const char* name = library->dlpi_name;
+        if (executable || !name || !name[0] || !strcmp(name, scan.self) ||
+            !hookedLibraries.visit(library->dlpi_addr)) {
+            return 0;
+        }
+
+        // A library read straight from an APK is named "<apk>!/<entry>" and
+        // mapped from the APK itself
+        char apk[PATH_MAX];
+        if (const char* entry = strstr(name, "!/")) {
+            size_t length = entry - name;
+            if (length >= sizeof(apk)) return 0;
+            memcpy(apk, name, length);
+            apk[length] = '\0';
+            name = apk;
+        }
+        struct stat file{};
+        if (stat(name, &file) != 0) return 0;
+
+        // Registering a file again, for a second library in one APK or a
+        // reload, must not make a hook its own original
+        static void* discarded;
+        auto registerAll = [&](const auto& hooks) {
+            for (const auto& hook : hooks) {
+                scan.api->pltHookRegister(file.st_dev, file.st_ino, hook.symbol, hook.replacement,
+                                          *hook.original ? &discarded : hook.original);
+            }
+        };
+        if (scan.opens) registerAll(OPEN_HOOKS);
+        if (scan.gl) registerAll(GL_HOOKS);
+        registerAll(DLOPEN_HOOKS);
+        scan.libraries++;
+        return 0;
+    }, &scan);
+    hookedLibraries.endScan();
+    return scan.libraries;
+}
+
+// -----------------------------------------------------------
+// Launch span, recorded into the per-process report on scope exit and
+// mirrored as a trace slice while markers are on
+// -----------------------------------------------------------
+#ifdef COPG_PHASE_PROBES
+// Host profiling harness, told about every span boundary when it is linked
+// into the executable
+extern "C" [[gnu::weak, gnu::visibility("default")]] void copg_phase_probe(LaunchPhase phase, bool begin);
+#define PHASE_PROBE(phase, begin) (copg_phase_probe ? copg_phase_probe(phase, begin) : (void) 0)
+#else
+#define PHASE_PROBE(phase, begin) ((void) 0)
+#endif
+
+class ScopedSpan {
+public:
+    ScopedSpan(LaunchReport &report, TraceMarker &trace, LaunchPhase phase)
+        : report(report), trace(trace, PHASE_NAMES[phase]), phase(phase), start(monotonicNs()) {
+        PHASE_PROBE(phase, true);
+    }
+    ~ScopedSpan() {
+        report.record(phase, start);
+        PHASE_PROBE(phase, false);
+    }
+
+private:
+    LaunchReport &report;
+    ScopedTrace trace;
+    LaunchPhase phase;
+    uint64_t start;
+};
+
 // -----------------------------------------------------------
 // Main Module Class
 // -----------------------------------------------------------
 class CombinedSpoofModule : public zygisk::ModuleBase {
 public:
-    CombinedSpoofModule() : api(nullptr), env(nullptr) {
-        // Initialize with empty configuration
-        deviceConfig.clear();
-    }
+    CombinedSpoofModule() : api(nullptr), env(nullptr), companionFd(-1), targeted(false), request{}, report{},
+                            profile{} {}
 
     void onLoad(zygisk::Api *api, JNIEnv *env) override {
         this->api = api;
         this->env = env;
-        LOGD("CombinedSpoofModule onLoad => module loaded successfully!");
+        BLOGD(binaryLog, MSG_MODULE_LOADED);
     }
 
     void preAppSpecialize(zygisk::AppSpecializeArgs *args) override {
+        uint64_t start = monotonicNs();
         if (!args) {
             LOGE("preAppSpecialize: Invalid arguments provided");
             if (api) api->setOption(zygisk::DLCLOSE_MODULE_LIBRARY);
             return;
         }
 
-        // Extract package name with enhanced error handling
-        if (!extractPackageName(args)) {
-            LOGE("Failed to extract package name");
+        // Everything is keyed on (userId, appId), derived from the target uid;
+        // isolated and other non-app processes are rejected without any IPC
+        AppKey key{};
+        {
+            ScopedSpan span(report, trace, PHASE_RESOLVE_UID);
+            request.uid = args->uid;
+            key = AppKey::fromUid(request.uid);
+            if (key.isApplication()) readProcessName(args->nice_name);
+        }
+        if (!key.isApplication()) {
+            BLOGD(binaryLog, MSG_NOT_APPLICATION, request.uid);
+            flushLogLocally();
             if (api) api->setOption(zygisk::DLCLOSE_MODULE_LIBRARY);
             return;
         }
 
-        LOGD("preAppSpecialize => packageName = %s", packageName.c_str());
+        BLOGD(binaryLog, MSG_PRE_APP, request.uid, key.userId, key.appId);
 
-        // Load and parse configuration
-        if (!loadConfiguration()) {
-            LOGE("Failed to load configuration");
-            if (api) api->setOption(zygisk::DLCLOSE_MODULE_LIBRARY);
+        // Without a user configuration the profiles built into the library
+        // decide, and the companion is never contacted
+        if (builtinConfigSelected()) {
+            bool matched;
+            {
+                ScopedSpan span(report, trace, PHASE_LOOKUP);
+                matched = lookupBuiltinProfile();
+            }
+            if (matched) {
+                if (api) api->setOption(zygisk::FORCE_DENYLIST_UNMOUNT);
+                applyBuildFields();
+            } else {
+                BLOGD(binaryLog, MSG_NOT_TARGETED, request.uid);
+                releaseConfiguration();
+            }
+            flushLogLocally();
+            if (api && !needsHooks()) api->setOption(zygisk::DLCLOSE_MODULE_LIBRARY);
             return;
         }
 
-        // Parse configuration and check if package is targeted
-        if (!parseConfiguration()) {
-            LOGD("Package [%s] not found in configuration => closing module", packageName.c_str());
+        // The companion owns the parsed configuration and answers with the
+        // device profile of this app, if any
+        if (!lookupDeviceConfig()) {
+            BLOGD(binaryLog, MSG_NOT_TARGETED, request.uid);
+            releaseConfiguration();
+            report.record(PHASE_SPECIALIZE, start);
+            sendLaunchReport();
+            trace.close();
             if (api) api->setOption(zygisk::DLCLOSE_MODULE_LIBRARY);
             return;
         }
@@ -296,292 +814,306 @@ public:
         // Force unmount DenyList for comprehensive spoofing
         if (api) api->setOption(zygisk::FORCE_DENYLIST_UNMOUNT);
 
-        LOGD("preAppSpecialize => keeping module active for package: %s", packageName.c_str());
-    }
+        // Build fields are plain static writes and go in now. Properties wait
+        // for postAppSpecialize: the property service decides on the caller's
+        // SELinux context, which has to be the app's and not zygote's. Zygisk
+        // only unloads the library after post either way.
+        applyBuildFields();
+        report.record(PHASE_SPECIALIZE, start);
+        keepForPost();
 
-    void postAppSpecialize(const zygisk::AppSpecializeArgs *args) override {
-        LOGD("postAppSpecialize => Beginning spoofing operations");
-        
-        // Update Build fields (Java layer spoofing)
-        if (env) {
-            BuildFieldManager buildManager(env);
-            if (buildManager.updateAllFields(deviceConfig)) {
-                LOGD("Build field spoofing completed successfully");
-            } else {
-                LOGE("Build field spoofing encountered errors");
-            }
-        } else {
-            LOGE("JNIEnv is null, skipping Build field spoofing");
+        if (!needsHooks()) {
+            BLOGD(binaryLog, MSG_SPOOFED_UNLOADING, request.uid);
+            if (api) api->setOption(zygisk::DLCLOSE_MODULE_LIBRARY);
+            return;
         }
 
-        // Spoof native system properties
-        PropertySpoofManager::spoofComprehensiveProperties(deviceConfig);
-        
-        LOGD("postAppSpecialize => All spoofing operations completed");
+        BLOGD(binaryLog, MSG_KEEPING_ACTIVE, request.uid);
+    }
 
-        // Cleanup resources
-        configJson.clear();
-        deviceConfig.clear();
-        packageName.clear();
+    void postAppSpecialize(const zygisk::AppSpecializeArgs *) override {
+        // Properties of a targeted app are set from the app's own context;
+        // hooks, if any, are installed once the app's libraries are all
+        // mapped. Zygisk unloads the library right after this returns unless
+        // hooks were installed.
+        // Markers are only still open here for targeted apps
+        {
+            ScopedTrace span(trace, "post_specialize");
+            if (targeted) applyProperties();
+            releaseConfiguration();
+            sendLaunchReport();
+            if (needsHooks()) installHooks();
+        }
+        trace.close();
     }
 
-    void preServerSpecialize(zygisk::ServerSpecializeArgs *args) override {
-        LOGD("preServerSpecialize => Closing module for system server");
+    void preServerSpecialize(zygisk::ServerSpecializeArgs *) override {
+        BLOGD(binaryLog, MSG_SERVER_CLOSING);
+        flushLogLocally();
         if (api) api->setOption(zygisk::DLCLOSE_MODULE_LIBRARY);
     }
 
 private:
     zygisk::Api *api;
     JNIEnv *env;
-    std::string packageName;
-    nlohmann::json configJson;
-    DeviceConfig deviceConfig;
+    int companionFd;  // Kept open from the lookup until the report is sent
+    bool targeted;    // Build fields applied, properties owed in post
+    LookupRequest request;
+    LaunchReport report;
+    TraceMarker trace;  // Opened once the companion says tracing is on
+    ProfileRecord profile;
+    char tail[PROPERTY_TAIL_MAX + SOC_TAIL_MAX];  // Properties, then SoC entries
 
-    bool extractPackageName(zygisk::AppSpecializeArgs *args) {
-        if (!env || !args || !args->app_data_dir) {
-            LOGE("Invalid arguments for package name extraction");
-            return false;
-        }
-        
-        auto dir = env->GetStringUTFChars(args->app_data_dir, nullptr);
-        if (!dir) {
-            LOGE("Failed to get app data directory");
-            return false;
-        }
-        
-        std::string dataDir(dir);
-        env->ReleaseStringUTFChars(args->app_data_dir, dir);
+    // Only SoC files and GL strings need hooks, every other targeted process
+    // drops the library right after preAppSpecialize. DLCLOSE_MODULE_LIBRARY
+    // must never be requested once a hook points into this library.
+    bool needsHooks() const {
+        return socFiles.size() > 0 || !glStrings.empty();
+    }
 
-        size_t pos = dataDir.rfind('/');
-        if (pos == std::string::npos || pos + 1 >= dataDir.size()) {
-            LOGE("Invalid app data directory format: %s", dataDir.c_str());
-            return false;
+    void installHooks() {
+        if (!api) return;
+        lateLoads.enable(api, socFiles.size() > 0, !glStrings.empty());
+        uint32_t libraries = registerPltHooks(api, socFiles.size() > 0, !glStrings.empty());
+        if (api->pltHookCommit()) {
+            BLOGD(binaryLog, MSG_HOOKS_INSTALLED, libraries);
+        } else {
+            LOGE("Failed to commit PLT hooks");
         }
-        
-        packageName = dataDir.substr(pos + 1);
+        flushLogLocally();
+    }
 
-        // Remove subprocess suffix if present
-        pos = packageName.find(':');
-        if (pos != std::string::npos) {
-            packageName = packageName.substr(0, pos);
-        }
-        
-        return !packageName.empty();
+    // Zygisk closes what preAppSpecialize opened unless it is exempted;
+    // whatever cannot be kept is finished here instead
+    void keepForPost() {
+        if (companionFd >= 0 && !(api && api->exemptFd(companionFd))) sendLaunchReport();
+        if (trace.enabled() && !(api && api->exemptFd(trace.descriptor()))) trace.close();
     }
 
-    bool loadConfiguration() {
-        if (!api) {
-            LOGE("API not available for companion connection");
-            return false;
+    // Everything of the profile that zygote's context can apply
+    void applyBuildFields() {
+        BLOGD(binaryLog, MSG_SPOOFING_BEGIN);
+        targeted = true;
+
+        // Update Build fields (Java layer spoofing)
+        if (env) {
+            ScopedSpan span(report, trace, PHASE_BUILD_FIELDS);
+            BuildFieldManager buildManager(env);
+            if (buildManager.updateAllFields(profile.config)) {
+                BLOGD(binaryLog, MSG_BUILD_FIELDS_DONE);
+            } else {
+                LOGE("Build field spoofing encountered errors");
+            }
+        } else {
+            LOGE("JNIEnv is null, skipping Build field spoofing");
         }
-        
-        // Connect to companion and receive JSON configuration
-        int fd = api->connectCompanion();
-        if (fd < 0) {
-            LOGE("Failed to connect to companion process");
-            return false;
+
+        // Served by the hooks installed in postAppSpecialize
+        if (profile.socCount) {
+            socFiles.build(tail + profile.propertyBytes, profile.socBytes, profile.socCount);
+            BLOGD(binaryLog, MSG_SOC_FILES_READY, socFiles.size());
+        }
+        glStrings.assign(profile.config);
+        if (!glStrings.empty()) {
+            BLOGD(binaryLog, MSG_GL_STRINGS_READY, profile.config.glRenderer, profile.config.glVendor);
         }
+    }
 
-        int jsonSize = 0;
-        if (xread(fd, &jsonSize, sizeof(jsonSize)) != sizeof(jsonSize)) {
-            LOGE("Failed to read JSON size from companion");
-            close(fd);
-            return false;
+    // Native system properties, set from the app's context
+    void applyProperties() {
+        {
+            ScopedSpan span(report, trace, PHASE_PROPERTIES);
+            PropertySpoofManager::applyProperties(profile.config, tail, profile.propertyBytes,
+                                                  profile.propertyCount);
         }
+        BLOGD(binaryLog, MSG_SPOOFING_DONE);
+    }
 
-        std::string jsonStr;
-        if (jsonSize > 0) {
-            jsonStr.resize(jsonSize);
-            if (xread(fd, jsonStr.data(), jsonSize) != jsonSize) {
-                LOGE("Failed to read complete JSON data from companion");
-                close(fd);
-                return false;
-            }
-            
-            // Parse JSON with comprehensive error checking
-            configJson = nlohmann::json::parse(jsonStr, nullptr, false, true);
-            if (configJson.is_discarded()) {
-                LOGE("Failed to parse JSON configuration - invalid format");
-                close(fd);
-                return false;
+    // Auxiliary processes (":push", ":remote") share the uid of their package;
+    // the companion matches the name against the package's process rules.
+    // GetStringUTFRegion copies into the request without allocating.
+    void readProcessName(jstring niceName) {
+        request.processLength = 0;
+        request.process[0] = '\0';
+        if (!env || !niceName) return;
+
+        request.processLength = static_cast<uint32_t>(env->GetStringUTFLength(niceName));
+        if (request.processLength >= sizeof(request.process)) return;
+        env->GetStringUTFRegion(niceName, 0, env->GetStringLength(niceName), request.process);
+        request.process[request.processLength] = '\0';
+    }
+
+    static bool builtinConfigSelected() {
+#ifdef COPG_BUILTIN_CONFIG
+        char value[PROP_VALUE_MAX];
+        return __system_property_get(BUILTIN_CONFIG_PROPERTY, value) > 0 && !strcmp(value, BUILTIN_CONFIG_VALUE);
+#else
+        return false;
+#endif
+    }
+
+    // Fills profile and tail the way the companion would; built-in
+    // profiles only cover main processes
+    bool lookupBuiltinProfile() {
+#ifdef COPG_BUILTIN_CONFIG
+        if (request.processLength == 0 || request.processLength >= sizeof(request.process)) return false;
+        const BuiltinProfile *builtin = findBuiltinProfile(request.process, [] {
+            char value[PROP_VALUE_MAX] = {};
+            __system_property_get("ro.build.version.sdk", value);
+            return static_cast<uint32_t>(strtoul(value, nullptr, 10));
+        });
+        if (!builtin) return false;
+
+        size_t index = 0;
+        DeviceConfig::forEachField(profile.config, [&](DeviceConfig::Field &field) {
+            strcpy(field, builtin->fields[index++]);
+        });
+
+        char *cursor = tail;
+        for (const auto &derived : DERIVED_PROPERTIES) {
+            const char *value = builtin->fields[derived.field];
+            if (!*value) continue;
+            for (const char *text : {static_cast<const char *>(derived.name), value}) {
+                size_t length = strlen(text) + 1;
+                memcpy(cursor, text, length);
+                cursor += length;
             }
+            profile.propertyCount++;
         }
-        
-        close(fd);
+        profile.propertyBytes = static_cast<uint32_t>(cursor - tail);
+
+        BLOGD(binaryLog, MSG_BUILTIN_MATCHED, request.process, profile.config.model);
         return true;
+#else
+        return false;
+#endif
+    }
+
+    void releaseConfiguration() {
+        targeted = false;
+        profile.config.clear();
+        memset(tail, 0, profile.propertyBytes + profile.socBytes);
+        profile.propertyCount = 0;
+        profile.propertyBytes = 0;
+        profile.socCount = 0;
+        profile.socBytes = 0;
     }
 
-    // Enhanced configuration parsing with better error handling
-    bool parseConfiguration() {
-        if (!configJson.is_object()) {
-            LOGE("Configuration JSON is not a valid object");
+    bool lookupDeviceConfig() {
+        if (!api) {
+            LOGE("API not available for companion connection");
             return false;
         }
 
-        // Find which device group this package belongs to
-        std::string deviceGroup = findDeviceGroup();
-        if (deviceGroup.empty()) {
-            LOGD("Package %s not found in any package list", packageName.c_str());
+        {
+            ScopedSpan span(report, trace, PHASE_CONNECT);
+            companionFd = api->connectCompanion();
+        }
+        if (companionFd < 0) {
+            LOGE("Failed to connect to companion process");
             return false;
         }
 
-        // Load corresponding device configuration
-        return loadDeviceConfiguration(deviceGroup);
-    }
-
-    std::string findDeviceGroup() {
-        for (auto& [key, value] : configJson.items()) {
-            if (!value.is_array() || key.find("PACKAGES_") != 0) {
-                continue;
-            }
-            
-            for (const auto& pkg : value) {
-                if (pkg.is_string() && pkg.get<std::string>() == packageName) {
-                    // Extract device group name (remove "PACKAGES_" prefix)
-                    return key.substr(9); // "PACKAGES_".length() = 9
-                }
-            }
+        ScopedSpan span(report, trace, PHASE_EXCHANGE);
+        int32_t status = LOOKUP_UNTARGETED;
+        if (xwrite(companionFd, &request, sizeof(request)) != sizeof(request) ||
+            xread(companionFd, &status, sizeof(status)) != sizeof(status)) {
+            LOGE("Failed to exchange lookup with companion");
+            closeCompanion();
+            return false;
         }
-        return "";
-    }
 
-    bool loadDeviceConfiguration(const std::string& deviceGroup) {
-        std::string deviceConfigKey = "PACKAGES_" + deviceGroup + "_DEVICE";
-        
-        if (!configJson.contains(deviceConfigKey)) {
-            LOGE("Device configuration %s not found", deviceConfigKey.c_str());
+        // Phases that ended before this point are not traced
+        if (status & LOOKUP_FLAG_TRACE) trace.open();
+        if ((status & LOOKUP_STATUS_MASK) != LOOKUP_TARGETED) {
             return false;
         }
 
-        auto deviceConfigNode = configJson[deviceConfigKey];
-        if (!deviceConfigNode.is_object()) {
-            LOGE("Device configuration %s is not a valid object", deviceConfigKey.c_str());
+        // The record and the tail are read straight into place, no
+        // intermediate copies
+        if (xread(companionFd, &profile, sizeof(profile)) != sizeof(profile) ||
+            profile.propertyBytes > PROPERTY_TAIL_MAX || profile.socBytes > SOC_TAIL_MAX ||
+            xread(companionFd, tail, profile.propertyBytes + profile.socBytes) !=
+                static_cast<ssize_t>(profile.propertyBytes + profile.socBytes)) {
+            LOGE("Failed to read device configuration from companion");
+            profile.propertyBytes = 0;
+            profile.socBytes = 0;
+            closeCompanion();
             return false;
         }
+        profile.config.terminate();
 
-        // Parse device configuration with validation
-        parseDeviceConfig(deviceConfigNode);
-        
-        LOGD("Package %s successfully matched to device group: %s", 
-             packageName.c_str(), deviceGroup.c_str());
+        BLOGD(binaryLog, MSG_CONFIG_RECEIVED, profile.config.brand, profile.config.model, profile.config.device,
+              profile.config.manufacturer, profile.config.product);
         return true;
     }
 
-    void parseDeviceConfig(const nlohmann::json& config) {
-        // Core device properties
-        parseConfigField(config, "BRAND", deviceConfig.brand);
-        parseConfigField(config, "DEVICE", deviceConfig.device);
-        parseConfigField(config, "MANUFACTURER", deviceConfig.manufacturer);
-        parseConfigField(config, "MODEL", deviceConfig.model);
-        parseConfigField(config, "FINGERPRINT", deviceConfig.fingerprint);
-        parseConfigField(config, "PRODUCT", deviceConfig.product);
-        
-        // Extended properties
-        parseConfigField(config, "BOARD", deviceConfig.board);
-        parseConfigField(config, "HARDWARE", deviceConfig.hardware);
-        parseConfigField(config, "SERIAL", deviceConfig.serial);
-
-        LOGD("Device configuration loaded successfully:");
-        LOGD("  Brand: %s, Model: %s, Device: %s", 
-             deviceConfig.brand.c_str(), deviceConfig.model.c_str(), deviceConfig.device.c_str());
-        LOGD("  Manufacturer: %s, Product: %s", 
-             deviceConfig.manufacturer.c_str(), deviceConfig.product.c_str());
+    // Specialization ends here for this module: hand the spans to the
+    // companion on the lookup connection and let go of it
+    void sendLaunchReport() {
+        if (companionFd < 0) {
+            flushLogLocally();
+            return;
+        }
+        ScopedTrace span(trace, "report");
+        report.logBytes = binaryLog.size();
+        report.logDropped = binaryLog.droppedCount();
+        if (xwrite(companionFd, &report, sizeof(report)) != sizeof(report) ||
+            xwrite(companionFd, binaryLog.data(), report.logBytes) != report.logBytes) {
+            LOGE("Failed to send launch report to companion");
+        }
+        binaryLog.reset();
+        closeCompanion();
     }
 
-    void parseConfigField(const nlohmann::json& config, const char* key, std::string& target) {
-        if (config.contains(key) && config[key].is_string()) {
-            target = config[key].get<std::string>();
-        }
+    void closeCompanion() {
+        if (companionFd >= 0) close(companionFd);
+        companionFd = -1;
     }
 };
 
 // -----------------------------------------------------------
-// File reading utilities with enhanced error handling
+// Companion trampoline
+//
+// Parsing, indexing and reloading live in a separate companion library so
+// that none of that code is mapped into app processes. Only the root
+// companion daemon ever loads it.
 // -----------------------------------------------------------
-static std::vector<uint8_t> readFile(const char *path) {
-    if (!path) {
-        LOGE("Invalid path provided to readFile");
-        return {};
-    }
-
-    FILE *file = fopen(path, "rb");
-    if (!file) {
-        LOGE("Failed to open configuration file: %s (error: %s)", path, strerror(errno));
-        return {};
-    }
+#if defined(__aarch64__)
+#define COMPANION_ABI "arm64-v8a"
+#elif defined(__arm__)
+#define COMPANION_ABI "armeabi-v7a"
+#elif defined(__x86_64__)
+#define COMPANION_ABI "x86_64"
+#elif defined(__i386__)
+#define COMPANION_ABI "x86"
+#endif
 
-    // Get file size
-    if (fseek(file, 0, SEEK_END) != 0) {
-        LOGE("Failed to seek to end of file: %s", path);
-        fclose(file);
-        return {};
-    }
+#ifndef COMPANION_LIB_PATH
+#define COMPANION_LIB_PATH MODULE_DIR "/companion/" COMPANION_ABI ".so"
+#endif
 
-    long size = ftell(file);
-    if (size < 0) {
-        LOGE("Failed to get file size: %s", path);
-        fclose(file);
-        return {};
-    }
+using CompanionHandler = void (*)(int);
 
-    if (fseek(file, 0, SEEK_SET) != 0) {
-        LOGE("Failed to seek to beginning of file: %s", path);
-        fclose(file);
-        return {};
+static CompanionHandler loadCompanionHandler() {
+    void *handle = dlopen(COMPANION_LIB_PATH, RTLD_NOW);
+    if (!handle) {
+        LOGE("Failed to load companion library: %s", dlerror());
+        return nullptr;
     }
-
-    if (size == 0) {
-        LOGD("Configuration file is empty: %s", path);
-        fclose(file);
-        return {};
+    auto handler = reinterpret_cast<CompanionHandler>(dlsym(handle, "copg_companion_handle"));
+    if (!handler) {
+        LOGE("Companion library has no request handler");
     }
-
-    // Read file contents
-    std::vector<uint8_t> buffer(size);
-    size_t bytesRead = fread(buffer.data(), 1, size, file);
-    fclose(file);
-
-    if (bytesRead != static_cast<size_t>(size)) {
-        LOGE("Failed to read complete file: %s (read %zu/%ld bytes)", 
-             path, bytesRead, size);
-        return {};
-    }
-
-    LOGD("Successfully read configuration file: %s (%ld bytes)", path, size);
-    return buffer;
+    return handler;
 }
 
-// Enhanced companion function with better error handling
 static void companion(int fd) {
-    LOGD("Companion process started, reading configuration");
-    
-    if (fd < 0) {
-        LOGE("Invalid file descriptor provided to companion");
-        return;
-    }
-    
-    std::vector<uint8_t> jsonData = readFile(CONFIG_PATH);
-    int jsonSize = static_cast<int>(jsonData.size());
-
-    LOGD("Companion sending JSON data (size: %d bytes)", jsonSize);
-
-    // Send size first
-    if (xwrite(fd, &jsonSize, sizeof(jsonSize)) != sizeof(jsonSize)) {
-        LOGE("Companion failed to send JSON size");
-        return;
-    }
-
-    // Send data if available
-    if (jsonSize > 0) {
-        if (xwrite(fd, jsonData.data(), jsonSize) != jsonSize) {
-            LOGE("Companion failed to send complete JSON data");
-            return;
-        }
-    }
-
-    LOGD("Companion successfully sent configuration data");
+    // Loaded once per companion daemon, thread-safe through the static init
+    static CompanionHandler handler = loadCompanionHandler();
+    if (handler) handler(fd);
 }
 
 // Register Zygisk module and companion
 REGISTER_ZYGISK_MODULE(CombinedSpoofModule)
-REGISTER_ZYGISK_COMPANION(companion)
\ No newline at end of file
+REGISTER_ZYGISK_COMPANION(companion)
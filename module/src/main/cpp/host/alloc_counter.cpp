@@ -0,0 +1,90 @@
+#include <malloc.h>
+#include <atomic>
+#include <cerrno>
+#include <cstddef>
+
+#include "alloc_counter.hpp"
+
+// glibc keeps its allocator reachable under these names for exactly this
+// kind of interposition
+extern "C" {
+void *__libc_malloc(size_t size);
+void *__libc_calloc(size_t count, size_t size);
+void *__libc_realloc(void *ptr, size_t size);
+void *__libc_memalign(size_t alignment, size_t size);
+void __libc_free(void *ptr);
+}
+
+namespace {
+
+thread_local AllocStats threadStats;
+std::atomic<int64_t> liveBytes;
+
+void *track(void *ptr) {
+    if (ptr) {
+        size_t size = malloc_usable_size(ptr);
+        threadStats.allocations++;
+        threadStats.bytes += size;
+        liveBytes.fetch_add(static_cast<int64_t>(size), std::memory_order_relaxed);
+    }
+    return ptr;
+}
+
+void untrack(void *ptr) {
+    if (ptr) {
+        liveBytes.fetch_sub(static_cast<int64_t>(malloc_usable_size(ptr)), std::memory_order_relaxed);
+    }
+}
+
+} // namespace
+
+AllocStats threadAllocStats() {
+    return threadStats;
+}
+
+int64_t liveHeapBytes() {
+    return liveBytes.load(std::memory_order_relaxed);
+}
+
+extern "C" {
+
+[[gnu::visibility("default")]] void *malloc(size_t size) {
+    return track(__libc_malloc(size));
+}
+
+[[gnu::visibility("default")]] void *calloc(size_t count, size_t size) {
+    return track(__libc_calloc(count, size));
+}
+
+[[gnu::visibility("default")]] void *realloc(void *ptr, size_t size) {
+    untrack(ptr);
+    void *result = __libc_realloc(ptr, size);
+    if (!result && ptr && size) {
+        // Failed realloc leaves the old block alive
+        liveBytes.fetch_add(static_cast<int64_t>(malloc_usable_size(ptr)), std::memory_order_relaxed);
+        return nullptr;
+    }
+    return track(result);
+}
+
+[[gnu::visibility("default")]] void *memalign(size_t alignment, size_t size) {
+    return track(__libc_memalign(alignment, size));
+}
+
+[[gnu::visibility("default")]] void *aligned_alloc(size_t alignment, size_t size) {
+    return track(__libc_memalign(alignment, size));
+}
+
+[[gnu::visibility("default")]] int posix_memalign(void **out, size_t alignment, size_t size) {
+    void *ptr = track(__libc_memalign(alignment, size));
+    if (!ptr) return ENOMEM;
+    *out = ptr;
+    return 0;
+}
+
+[[gnu::visibility("default")]] void free(void *ptr) {
+    untrack(ptr);
+    __libc_free(ptr);
+}
+
+}
@@ -0,0 +1,30 @@
+#pragma once
+
+#include <cstdint>
+
+// Interposed malloc family. Linking alloc_counter.cpp into an executable
+// routes every allocation of the process, dlopen-ed libraries included,
+// through these counters.
+
+struct AllocStats {
+    uint64_t allocations;
+    uint64_t bytes;
+};
+
+// Allocations made by the calling thread so far
+AllocStats threadAllocStats();
+
+// Bytes currently allocated by the whole process
+int64_t liveHeapBytes();
+
+// Allocations made by the calling thread while the scope is alive
+class AllocScope {
+public:
+    AllocScope() : start(threadAllocStats()) {}
+
+    uint64_t allocations() const { return threadAllocStats().allocations - start.allocations; }
+    uint64_t bytes() const { return threadAllocStats().bytes - start.bytes; }
+
+private:
+    AllocStats start;
+};
@@ -0,0 +1,114 @@
+#include <android/log.h>
+#include <sys/system_properties.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+
+#include "android_stubs.hpp"
+
+// Stand-ins for liblog and the bionic property area. Neither touches the
+// heap, so they never show up in the allocation counts of the module.
+
+// -----------------------------------------------------------
+// liblog
+// -----------------------------------------------------------
+static std::atomic<int> logCounts[ANDROID_LOG_SILENT + 1];
+
+extern "C" int __android_log_print(int prio, const char *tag, const char *fmt, ...) {
+    if (prio >= 0 && prio <= ANDROID_LOG_SILENT) logCounts[prio]++;
+
+    // Quiet unless asked for, the benchmarks print their own results
+    if (!getenv("COPG_HOST_LOG")) return 0;
+
+    char line[1024];
+    va_list args;
+    va_start(args, fmt);
+    int prefix = snprintf(line, sizeof(line), "[%d] %s: ", prio, tag);
+    int body = vsnprintf(line + prefix, sizeof(line) - prefix - 1, fmt, args);
+    va_end(args);
+
+    size_t length = prefix + (body < 0 ? 0 : body);
+    if (length > sizeof(line) - 2) length = sizeof(line) - 2;
+    line[length++] = '\n';
+    return static_cast<int>(write(STDERR_FILENO, line, length));
+}
+
+extern "C" int copg_host_log_count(int prio) {
+    int total = 0;
+    for (int i = prio; i <= ANDROID_LOG_SILENT; i++) total += logCounts[i];
+    return total;
+}
+
+extern "C" void copg_host_log_reset() {
+    for (auto &count : logCounts) count = 0;
+}
+
+// -----------------------------------------------------------
+// System properties
+// -----------------------------------------------------------
+namespace {
+
+struct PropertySlot {
+    char name[128];
+    char value[PROP_VALUE_MAX];
+};
+
+constexpr size_t MAX_PROPERTIES = 512;
+
+std::mutex propertyMutex;
+PropertySlot properties[MAX_PROPERTIES];
+size_t propertyCount;
+int setCount;
+
+PropertySlot *findProperty(const char *name) {
+    for (size_t i = 0; i < propertyCount; i++) {
+        if (strcmp(properties[i].name, name) == 0) return &properties[i];
+    }
+    return nullptr;
+}
+
+} // namespace
+
+extern "C" int __system_property_set(const char *name, const char *value) {
+    if (!name || !value || strlen(name) >= sizeof(PropertySlot::name) ||
+        strlen(value) >= PROP_VALUE_MAX) {
+        return -1;
+    }
+
+    std::lock_guard<std::mutex> lock(propertyMutex);
+    PropertySlot *slot = findProperty(name);
+    if (!slot) {
+        if (propertyCount == MAX_PROPERTIES) return -1;
+        slot = &properties[propertyCount++];
+        strcpy(slot->name, name);
+    }
+    strcpy(slot->value, value);
+    setCount++;
+    return 0;
+}
+
+extern "C" int __system_property_get(const char *name, char *value) {
+    std::lock_guard<std::mutex> lock(propertyMutex);
+    const PropertySlot *slot = findProperty(name);
+    if (!slot) {
+        value[0] = '\0';
+        return 0;
+    }
+    strcpy(value, slot->value);
+    return static_cast<int>(strlen(value));
+}
+
+extern "C" void copg_host_properties_reset() {
+    std::lock_guard<std::mutex> lock(propertyMutex);
+    propertyCount = 0;
+    setCount = 0;
+}
+
+extern "C" int copg_host_properties_set_count() {
+    std::lock_guard<std::mutex> lock(propertyMutex);
+    return setCount;
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+// Test-side access to the state behind the liblog and property stand-ins
+
+extern "C" {
+
+// Drops every property set so far
+void copg_host_properties_reset();
+
+// Number of __system_property_set calls since the last reset
+int copg_host_properties_set_count();
+
+// Number of log lines printed at or above prio since the last reset
+int copg_host_log_count(int prio);
+void copg_host_log_reset();
+
+}
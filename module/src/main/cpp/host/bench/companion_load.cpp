@@ -0,0 +1,204 @@
+// Concurrent companion load
+//
+// Replays a boot storm against the companion in-process: every request gets
+// a socketpair, one end is served on a fresh thread through
+// zygisk_companion_entry (zygiskd spawns a thread per connection too) and
+// the other end is driven by one of T client threads. Each sweep point
+// reports throughput, request latency as seen by the client, and the libc
+// I/O calls, bytes and heap allocations the companion side spent per
+// request. The calls are the interposed libc entry points of io_counter,
+// not kernel syscalls: what libc and the STL issue internally (fstat,
+// mmap, getdents, stdio refills) is not seen.
+//
+// Usage: copg_bench_companion_load [--requests N] [--threads a,b,...]
+//                                  [--groups N] [--per-group N]
+//                                  [--users N] [--hit-ratio 0..1]
+
+#include <dlfcn.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "alloc_counter.hpp"
+#include "generator.hpp"
+#include "io_counter.hpp"
+#include "latency.hpp"
+#include "protocol.hpp"
+
+namespace {
+
+using CompanionEntry = void (*)(int);
+
+struct Options {
+    int requests = 20000;
+    int users = 1;
+    double hitRatio = 0.5;
+    GeneratorOptions shape{.groups = 64};
+    std::vector<int> threads{1, 4, 16, 64, 256};
+};
+
+// Companion-side cost, summed over every served request
+struct ServerTotals {
+    std::atomic<uint64_t> libcIoCalls{0};
+    std::atomic<uint64_t> ioBytes{0};
+    std::atomic<uint64_t> allocations{0};
+    std::atomic<uint64_t> failures{0};
+};
+
+void serve(CompanionEntry entry, int fd, ServerTotals &totals) {
+    IoScope io;
+    AllocScope allocs;
+    entry(fd);
+    close(fd);
+    totals.libcIoCalls.fetch_add(io.calls(), std::memory_order_relaxed);
+    totals.ioBytes.fetch_add(io.bytes(), std::memory_order_relaxed);
+    totals.allocations.fetch_add(allocs.allocations(), std::memory_order_relaxed);
+}
+
+// One launch from the app's point of view: request out, status and
+// profile back, launch report out
+bool lookup(CompanionEntry entry, const GeneratedLaunch &launch, ServerTotals &totals) {
+    int fds[2];
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) != 0) return false;
+    std::thread server(serve, entry, fds[1], std::ref(totals));
+
+    LookupRequest request{};
+    request.uid = launch.uid;
+    int32_t status = LOOKUP_UNTARGETED;
+    ProfileRecord profile;
+    char tail[PROPERTY_TAIL_MAX + SOC_TAIL_MAX];
+    LaunchReport report{};
+    bool ok = xwrite(fds[0], &request, sizeof(request)) == sizeof(request) &&
+              xread(fds[0], &status, sizeof(status)) == sizeof(status);
+    bool targeted = (status & LOOKUP_STATUS_MASK) == LOOKUP_TARGETED;
+    ok = ok && (!targeted ||
+                (xread(fds[0], &profile, sizeof(profile)) == sizeof(profile) &&
+                 profile.propertyBytes <= PROPERTY_TAIL_MAX && profile.socBytes <= SOC_TAIL_MAX &&
+                 xread(fds[0], tail, profile.propertyBytes + profile.socBytes) ==
+                     static_cast<ssize_t>(profile.propertyBytes + profile.socBytes))) &&
+         xwrite(fds[0], &report, sizeof(report)) == sizeof(report);
+    close(fds[0]);
+    server.join();
+    return ok && targeted == launch.targeted;
+}
+
+void runSweepPoint(CompanionEntry entry, const std::vector<GeneratedLaunch> &trace, int threadCount) {
+    ServerTotals totals;
+    std::vector<LatencySeries> latencies(threadCount);
+    std::vector<std::thread> clients;
+    std::atomic<bool> go{false};
+
+    // Client i replays every threadCount-th launch of the trace
+    for (int i = 0; i < threadCount; i++) {
+        clients.emplace_back([&, i] {
+            while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+            for (size_t n = i; n < trace.size(); n += threadCount) {
+                uint64_t start = monotonicNs();
+                if (!lookup(entry, trace[n], totals)) {
+                    totals.failures.fetch_add(1, std::memory_order_relaxed);
+                    continue;
+                }
+                latencies[i].add(monotonicNs() - start);
+            }
+        });
+    }
+
+    uint64_t start = monotonicNs();
+    go.store(true, std::memory_order_release);
+    for (auto &client : clients) client.join();
+    double seconds = (monotonicNs() - start) / 1e9;
+
+    LatencySeries all;
+    for (auto &series : latencies) all.merge(series);
+    double requests = static_cast<double>(trace.size());
+    printf("%7d %9zu %10.0f %9.1f %9.1f %9.1f %11.2f %8.1f %9.2f\n",
+           threadCount, all.size(), requests / seconds,
+           all.percentile(50) / 1e3, all.percentile(99) / 1e3, all.percentile(99.9) / 1e3,
+           totals.libcIoCalls.load() / requests, totals.ioBytes.load() / requests,
+           totals.allocations.load() / requests);
+    if (totals.failures.load()) {
+        fprintf(stderr, "%llu requests failed\n", static_cast<unsigned long long>(totals.failures.load()));
+    }
+}
+
+bool parseOptions(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) return false;
+        if (!strcmp(argv[i], "--requests")) {
+            options.requests = atoi(value);
+        } else if (!strcmp(argv[i], "--groups")) {
+            options.shape.groups = atoi(value);
+        } else if (!strcmp(argv[i], "--per-group")) {
+            options.shape.packagesPerGroup = atoi(value);
+        } else if (!strcmp(argv[i], "--users")) {
+            options.users = atoi(value);
+        } else if (!strcmp(argv[i], "--hit-ratio")) {
+            options.hitRatio = atof(value);
+        } else if (!strcmp(argv[i], "--threads")) {
+            options.threads.clear();
+            for (const char *p = value; p; p = strchr(p, ',')) {
+                if (*p == ',') p++;
+                options.threads.push_back(atoi(p));
+            }
+        } else {
+            return false;
+        }
+        i++;
+    }
+    for (int threads : options.threads) {
+        if (threads <= 0) return false;
+    }
+    return options.requests > 0 && options.shape.groups > 0 && options.shape.packagesPerGroup > 0 &&
+           options.users > 0 && !options.threads.empty() &&
+           options.hitRatio >= 0 && options.hitRatio <= 1;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        fprintf(stderr, "usage: %s [--requests N] [--threads a,b,...] [--groups N] [--per-group N] "
+                        "[--users N] [--hit-ratio 0..1]\n",
+                argv[0]);
+        return 2;
+    }
+
+    ConfigGenerator generator(options.shape);
+    if (!generator.writeModuleFiles()) {
+        fprintf(stderr, "failed to write module files\n");
+        return 1;
+    }
+    std::vector<GeneratedLaunch> trace = generator.trace(options.requests, options.hitRatio, options.users);
+
+    void *module = dlopen(COPG_HOST_MODULE_PATH, RTLD_NOW);
+    auto entry = module ? reinterpret_cast<CompanionEntry>(dlsym(module, "zygisk_companion_entry")) : nullptr;
+    if (!entry) {
+        fprintf(stderr, "cannot load %s: %s\n", COPG_HOST_MODULE_PATH, dlerror());
+        return 1;
+    }
+
+    // Loads the companion library and compiles the snapshot, both once per boot
+    ServerTotals warmup;
+    lookup(entry, trace.front(), warmup);
+
+    printf("companion load, %d requests per point, %d targeted of %d installed packages, "
+           "%d users, hit ratio %.2f\n",
+           options.requests, generator.targetedPackages(),
+           generator.targetedPackages() + generator.plainPackages(), options.users, options.hitRatio);
+    printf("%7s %9s %10s %9s %9s %9s %11s %8s %9s\n", "threads", "requests", "req/s",
+           "p50_us", "p99_us", "p99.9_us", "libc_io/req", "B/req", "alloc/req");
+    for (int threads : options.threads) {
+        runSweepPoint(entry, trace, threads);
+    }
+
+    ConfigGenerator::removeModuleFiles();
+    return 0;
+}
@@ -0,0 +1,125 @@
+// dlopen/dlclose cost of the module libraries
+//
+// Zygisk maps the app-side library into every forked app and drops it again
+// after specialization, so its load cost is paid on every launch. Each cycle
+// dlopen-s a library with RTLD_NOW, as Zygisk does, and dlclose-s it again,
+// recording wall time and the minor page faults both steps take. The first
+// cycle is reported on its own: it is what the first launch after boot pays.
+//
+// Usage: copg_bench_dlopen [--cycles N] [LIBRARY...]
+
+#include <dlfcn.h>
+#include <sys/resource.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "fake_zygisk.hpp"
+#include "latency.hpp"
+
+namespace {
+
+struct Options {
+    int cycles = 500;
+    std::vector<const char *> libraries;
+};
+
+long minorFaults() {
+    rusage usage{};
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_minflt;
+}
+
+struct Cycle {
+    uint64_t openNs;
+    uint64_t closeNs;
+    long openFaults;
+    long closeFaults;
+};
+
+bool runCycle(const char *path, Cycle &cycle) {
+    long faults = minorFaults();
+    uint64_t start = monotonicNs();
+    void *handle = dlopen(path, RTLD_NOW);
+    cycle.openNs = monotonicNs() - start;
+    cycle.openFaults = minorFaults() - faults;
+    if (!handle) {
+        fprintf(stderr, "dlopen %s: %s\n", path, dlerror());
+        return false;
+    }
+
+    faults = minorFaults();
+    start = monotonicNs();
+    dlclose(handle);
+    cycle.closeNs = monotonicNs() - start;
+    cycle.closeFaults = minorFaults() - faults;
+    return true;
+}
+
+bool measure(const Options &options, const char *path) {
+    const char *name = strrchr(path, '/') ? strrchr(path, '/') + 1 : path;
+
+    Cycle first{};
+    if (!runCycle(path, first)) return false;
+    // A library that stays mapped (e.g. pinned by STB_GNU_UNIQUE symbols)
+    // only pays relocation once, which the warm numbers would hide
+    bool unloads = !isMapped(path);
+
+    LatencySeries open;
+    LatencySeries close;
+    long openFaults = 0;
+    long closeFaults = 0;
+    for (int i = 0; i < options.cycles; i++) {
+        Cycle cycle{};
+        if (!runCycle(path, cycle)) return false;
+        open.add(cycle.openNs);
+        close.add(cycle.closeNs);
+        openFaults += cycle.openFaults;
+        closeFaults += cycle.closeFaults;
+    }
+
+    printf("%-28s first dlopen %.1f us (%ld faults), dlclose %.1f us (%ld faults)%s\n", name,
+           first.openNs / 1e3, first.openFaults, first.closeNs / 1e3, first.closeFaults,
+           unloads ? "" : ", stays mapped after dlclose");
+    printf("%-28s %.1f minor faults per dlopen, %.1f per dlclose\n", name,
+           static_cast<double>(openFaults) / options.cycles, static_cast<double>(closeFaults) / options.cycles);
+    LatencySeries::printHeader("library");
+    open.print(name, "dlopen");
+    close.print(name, "dlclose");
+    return true;
+}
+
+bool parseOptions(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--cycles") && i + 1 < argc) {
+            options.cycles = atoi(argv[++i]);
+        } else if (argv[i][0] == '-') {
+            return false;
+        } else {
+            options.libraries.push_back(argv[i]);
+        }
+    }
+    if (options.libraries.empty()) {
+        options.libraries = {COPG_HOST_MODULE_PATH, COPG_HOST_COMPANION_PATH};
+    }
+    return options.cycles > 0;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        fprintf(stderr, "usage: %s [--cycles N] [LIBRARY...]\n", argv[0]);
+        return 2;
+    }
+
+    printf("dlopen(RTLD_NOW) + dlclose, %d warm cycles per library\n", options.cycles);
+    bool ok = true;
+    for (const char *library : options.libraries) {
+        printf("\n");
+        ok = measure(options, library) && ok;
+    }
+    return ok ? 0 : 1;
+}
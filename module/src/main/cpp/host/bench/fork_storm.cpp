@@ -0,0 +1,198 @@
+// Fork-storm launch latency
+//
+// Every launch forks a child from this process the way zygote forks an app:
+// the child loads the host module through zygisk_module_entry, runs pre and
+// post specialization against the companion daemon, unloads the module if
+// asked to, and reports the moment it is ready. The parent records
+// fork-to-ready latency, split by targeted and untargeted apps, for each
+// config size (in device profile groups) in the sweep.
+//
+// Usage: copg_bench_fork_storm [--launches N] [--concurrency N]
+//                              [--groups a,b,...] [--per-group N]
+//                              [--hit-ratio 0..1]
+
+#include <fcntl.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "fake_zygisk.hpp"
+#include "latency.hpp"
+#include "generator.hpp"
+#include "module_files.hpp"
+#include "protocol.hpp"
+
+namespace {
+
+struct Options {
+    int launches = 2000;
+    int concurrency = 1;
+    int packagesPerGroup = 16;
+    double hitRatio = 0.5;
+    std::vector<int> groups{1, 16, 256};
+};
+
+// What a child reports through the shared pipe; well below PIPE_BUF, so
+// concurrent writes never interleave
+struct ReadyMessage {
+    int32_t launch;
+    int32_t ok;
+    uint64_t readyNs;
+};
+
+// -----------------------------------------------------------
+// Launching
+// -----------------------------------------------------------
+[[noreturn]] void runChild(int launch, const AppProcess &process,
+                           const FakeCompanionDaemon &companion, int readyFd) {
+    FakeJvm jvm;
+    FakeZygisk zygisk(jvm, &companion);
+    ReadyMessage message{launch, 0, 0};
+    if (zygisk.load()) {
+        zygisk.preAppSpecialize(process);
+        zygisk.postAppSpecialize();
+        if (zygisk.dlcloseRequested) zygisk.unload();
+        message.ok = 1;
+    }
+    message.readyNs = monotonicNs();
+    (void) !write(readyFd, &message, sizeof(message));
+    _exit(0);
+}
+
+bool runSweepPoint(const Options &options, const FakeCompanionDaemon &companion, int groups) {
+    GeneratorOptions shape;
+    shape.groups = groups;
+    shape.packagesPerGroup = options.packagesPerGroup;
+    ConfigGenerator generator(shape);
+    if (!generator.writeModuleFiles()) {
+        fprintf(stderr, "failed to write module files\n");
+        return false;
+    }
+    std::vector<GeneratedLaunch> launches = generator.trace(options.launches, options.hitRatio);
+
+    int pipeFds[2];
+    if (pipe2(pipeFds, O_CLOEXEC) != 0) return false;
+
+    // The first lookup after a config change compiles the snapshot; that is
+    // a once-per-boot cost and stays out of the launch numbers
+    {
+        FakeJvm jvm;
+        FakeZygisk warmup(jvm, &companion);
+        warmup.runApp({static_cast<int>(AID_APP_START), nullptr, nullptr});
+    }
+
+    std::vector<uint64_t> forkNs(launches.size());
+    LatencySeries targeted;
+    LatencySeries untargeted;
+    size_t started = 0;
+    size_t finished = 0;
+    size_t reaped = 0;
+    int failed = 0;
+
+    while (finished < launches.size()) {
+        while (started < launches.size() && started - finished < static_cast<size_t>(options.concurrency)) {
+            forkNs[started] = monotonicNs();
+            pid_t pid = fork();
+            if (pid == 0) {
+                close(pipeFds[0]);
+                runChild(static_cast<int>(started), {launches[started].uid, nullptr, nullptr},
+                         companion, pipeFds[1]);
+            }
+            if (pid < 0) {
+                perror("fork");
+                return false;
+            }
+            started++;
+        }
+
+        ReadyMessage message{};
+        if (read(pipeFds[0], &message, sizeof(message)) != sizeof(message)) {
+            perror("read");
+            return false;
+        }
+        while (reaped < started && waitpid(-1, nullptr, WNOHANG) > 0) reaped++;
+        finished++;
+
+        if (!message.ok) {
+            failed++;
+            continue;
+        }
+        uint64_t latency = message.readyNs - forkNs[message.launch];
+        (launches[message.launch].targeted ? targeted : untargeted).add(latency);
+    }
+    // The companion daemon is a child as well, so only count launches
+    while (reaped < started && waitpid(-1, nullptr, 0) > 0) reaped++;
+    close(pipeFds[0]);
+    close(pipeFds[1]);
+
+    char label[32];
+    snprintf(label, sizeof(label), "%d", generator.targetedPackages());
+    targeted.print(label, "targeted");
+    untargeted.print(label, "untargeted");
+    if (failed) fprintf(stderr, "%d launches failed to load the module\n", failed);
+    return failed == 0;
+}
+
+bool parseOptions(int argc, char **argv, Options &options) {
+    for (int i = 1; i < argc; i++) {
+        const char *value = i + 1 < argc ? argv[i + 1] : nullptr;
+        if (!value) return false;
+        if (!strcmp(argv[i], "--launches")) {
+            options.launches = atoi(value);
+        } else if (!strcmp(argv[i], "--concurrency")) {
+            options.concurrency = atoi(value);
+        } else if (!strcmp(argv[i], "--hit-ratio")) {
+            options.hitRatio = atof(value);
+        } else if (!strcmp(argv[i], "--per-group")) {
+            options.packagesPerGroup = atoi(value);
+        } else if (!strcmp(argv[i], "--groups")) {
+            options.groups.clear();
+            for (const char *p = value; p; p = strchr(p, ',')) {
+                if (*p == ',') p++;
+                options.groups.push_back(atoi(p));
+            }
+        } else {
+            return false;
+        }
+        i++;
+    }
+    for (int groups : options.groups) {
+        if (groups <= 0) return false;
+    }
+    return options.launches > 0 && options.concurrency > 0 && !options.groups.empty() &&
+           options.packagesPerGroup > 0 &&
+           options.hitRatio >= 0 && options.hitRatio <= 1;
+}
+
+} // namespace
+
+int main(int argc, char **argv) {
+    Options options;
+    if (!parseOptions(argc, argv, options)) {
+        fprintf(stderr, "usage: %s [--launches N] [--concurrency N] [--groups a,b,...] [--per-group N] [--hit-ratio 0..1]\n",
+                argv[0]);
+        return 2;
+    }
+
+    FakeCompanionDaemon companion;
+    if (!ModuleFiles::prepare() || !companion.start()) {
+        fprintf(stderr, "failed to start the companion daemon\n");
+        return 1;
+    }
+
+    printf("fork-to-ready latency, %d launches per config, concurrency %d, hit ratio %.2f\n",
+           options.launches, options.concurrency, options.hitRatio);
+    LatencySeries::printHeader("config_pkgs");
+
+    bool ok = true;
+    for (int groups : options.groups) {
+        ok = runSweepPoint(options, companion, groups) && ok;
+    }
+
+    ConfigGenerator::removeModuleFiles();
+    companion.stop();
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <vector>
+
+#include "common.hpp"
+
+// Latency samples of one series, reported as nearest-rank percentiles
+class LatencySeries {
+public:
+    void add(uint64_t ns) { samples.push_back(ns); }
+    size_t size() const { return samples.size(); }
+
+    void merge(const LatencySeries &other) {
+        samples.insert(samples.end(), other.samples.begin(), other.samples.end());
+    }
+
+    uint64_t percentile(double p) {
+        if (samples.empty()) return 0;
+        std::sort(samples.begin(), samples.end());
+        size_t rank = static_cast<size_t>(p / 100.0 * samples.size() + 0.999999);
+        return samples[std::clamp<size_t>(rank, 1, samples.size()) - 1];
+    }
+
+    static void printHeader(const char *label) {
+        printf("%-12s %-11s %7s %10s %10s %10s %10s\n",
+               label, "series", "n", "p50_us", "p99_us", "p99.9_us", "max_us");
+    }
+
+    void print(const char *label, const char *series) {
+        printf("%-12s %-11s %7zu %10.1f %10.1f %10.1f %10.1f\n", label, series, size(),
+               percentile(50) / 1e3, percentile(99) / 1e3, percentile(99.9) / 1e3,
+               percentile(100) / 1e3);
+    }
+
+private:
+    std::vector<uint64_t> samples;
+};
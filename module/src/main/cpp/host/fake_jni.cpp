@@ -0,0 +1,226 @@
+#include <cstring>
+
+#include "fake_jni.hpp"
+
+namespace {
+
+const char *const BUILD_CLASS = "android/os/Build";
+const char *const VERSION_CLASS = "android/os/Build$VERSION";
+
+// Classes are identified by the address of these tags
+_jclass buildClassTag;
+_jclass versionClassTag;
+
+} // namespace
+
+struct FakeJniFunctions {
+    static jclass FindClass(JNIEnv *env, const char *name) {
+        auto *jvm = FakeJvm::called(env, JniFunction::FindClass);
+        jclass clazz = jvm->classFor(name);
+        if (!clazz) {
+            jvm->pendingException = true;
+            return nullptr;
+        }
+        jvm->localRefs++;
+        return clazz;
+    }
+
+    static jthrowable ExceptionOccurred(JNIEnv *env) {
+        static _jthrowable pending;
+        return FakeJvm::called(env, JniFunction::ExceptionOccurred)->pendingException ? &pending : nullptr;
+    }
+
+    static void ExceptionClear(JNIEnv *env) {
+        FakeJvm::called(env, JniFunction::ExceptionClear)->pendingException = false;
+    }
+
+    static void DeleteLocalRef(JNIEnv *env, jobject obj) {
+        auto *jvm = FakeJvm::called(env, JniFunction::DeleteLocalRef);
+        if (!obj) return;
+        jvm->localRefs--;
+        if (obj != &buildClassTag && obj != &versionClassTag) {
+            FakeJvm::release(reinterpret_cast<FakeJvm::StringSlot *>(obj));
+        }
+    }
+
+    static jfieldID GetStaticFieldID(JNIEnv *env, jclass clazz, const char *name, const char *sig) {
+        auto *jvm = FakeJvm::called(env, JniFunction::GetStaticFieldID);
+        const char *className = jvm->classNameOf(clazz);
+        if (className && strcmp(sig, "Ljava/lang/String;") == 0) {
+            for (int i = 0; i < jvm->fieldCount; i++) {
+                FakeJvm::FieldSlot &field = jvm->fields[i];
+                if (field.className == className && strcmp(field.name, name) == 0) {
+                    return reinterpret_cast<jfieldID>(&field);
+                }
+            }
+        }
+        jvm->pendingException = true; // NoSuchFieldError
+        return nullptr;
+    }
+
+    static jobject GetStaticObjectField(JNIEnv *env, jclass, jfieldID fieldID) {
+        auto *jvm = FakeJvm::called(env, JniFunction::GetStaticObjectField);
+        auto *field = reinterpret_cast<FakeJvm::FieldSlot *>(fieldID);
+        if (!field->value) return nullptr;
+        field->value->refs++;
+        jvm->localRefs++;
+        return reinterpret_cast<jobject>(field->value);
+    }
+
+    static void SetStaticObjectField(JNIEnv *env, jclass, jfieldID fieldID, jobject value) {
+        FakeJvm::called(env, JniFunction::SetStaticObjectField);
+        auto *field = reinterpret_cast<FakeJvm::FieldSlot *>(fieldID);
+        auto *slot = reinterpret_cast<FakeJvm::StringSlot *>(value);
+        if (slot) slot->refs++;
+        FakeJvm::release(field->value);
+        field->value = slot;
+    }
+
+    static jstring NewStringUTF(JNIEnv *env, const char *bytes) {
+        auto *jvm = FakeJvm::called(env, JniFunction::NewStringUTF);
+        FakeJvm::StringSlot *slot = jvm->allocString(bytes);
+        if (slot) jvm->localRefs++;
+        return reinterpret_cast<jstring>(slot);
+    }
+
+    static jsize GetStringLength(JNIEnv *env, jstring string) {
+        FakeJvm::called(env, JniFunction::GetStringLength);
+        return lengthOf(string);
+    }
+
+    static jsize GetStringUTFLength(JNIEnv *env, jstring string) {
+        FakeJvm::called(env, JniFunction::GetStringUTFLength);
+        return lengthOf(string);
+    }
+
+    static const char *GetStringUTFChars(JNIEnv *env, jstring string, jboolean *isCopy) {
+        FakeJvm::called(env, JniFunction::GetStringUTFChars);
+        if (isCopy) *isCopy = JNI_FALSE;
+        return reinterpret_cast<FakeJvm::StringSlot *>(string)->utf;
+    }
+
+    static void ReleaseStringUTFChars(JNIEnv *env, jstring, const char *) {
+        FakeJvm::called(env, JniFunction::ReleaseStringUTFChars);
+    }
+
+    static void GetStringUTFRegion(JNIEnv *env, jstring str, jsize start, jsize len, char *buf) {
+        FakeJvm::called(env, JniFunction::GetStringUTFRegion);
+        memcpy(buf, reinterpret_cast<FakeJvm::StringSlot *>(str)->utf + start, len);
+    }
+
+    static jboolean ExceptionCheck(JNIEnv *env) {
+        return FakeJvm::called(env, JniFunction::ExceptionCheck)->pendingException ? JNI_TRUE : JNI_FALSE;
+    }
+
+    // The fake only ever holds ASCII, where UTF-16 and modified UTF-8
+    // lengths agree
+    static jsize lengthOf(jstring string) {
+        return static_cast<jsize>(strlen(reinterpret_cast<FakeJvm::StringSlot *>(string)->utf));
+    }
+
+    static constexpr JNINativeInterface table = {
+        nullptr,
+        FindClass,
+        ExceptionOccurred,
+        ExceptionClear,
+        DeleteLocalRef,
+        GetStaticFieldID,
+        GetStaticObjectField,
+        SetStaticObjectField,
+        NewStringUTF,
+        GetStringLength,
+        GetStringUTFLength,
+        GetStringUTFChars,
+        ReleaseStringUTFChars,
+        GetStringUTFRegion,
+        ExceptionCheck,
+    };
+};
+
+int JniCallCounts::total() const {
+    int sum = 0;
+    for (int count : calls) sum += count;
+    return sum;
+}
+
+const char *JniCallCounts::name(JniFunction function) {
+    static const char *const names[] = {
+#define FAKE_JNI_FUNCTION_NAME(name) #name,
+        FAKE_JNI_FUNCTIONS(FAKE_JNI_FUNCTION_NAME)
+#undef FAKE_JNI_FUNCTION_NAME
+    };
+    return names[static_cast<int>(function)];
+}
+
+FakeJvm::FakeJvm() {
+    env_.functions = &FakeJniFunctions::table;
+    resetCallCounts();
+    reset();
+}
+
+void FakeJvm::resetCallCounts() {
+    calls = {};
+}
+
+void FakeJvm::reset() {
+    pendingException = false;
+    localRefs = 0;
+    memset(strings, 0, sizeof(strings));
+
+    static const char *const buildFields[] = {
+        "BRAND", "DEVICE", "MANUFACTURER", "MODEL", "FINGERPRINT",
+        "PRODUCT", "BOARD", "HARDWARE", "SERIAL",
+    };
+    fieldCount = 0;
+    for (const char *name : buildFields) {
+        fields[fieldCount++] = {BUILD_CLASS, name, nullptr};
+    }
+    fields[fieldCount++] = {VERSION_CLASS, "RELEASE", nullptr};
+    fields[fieldCount++] = {VERSION_CLASS, "INCREMENTAL", nullptr};
+}
+
+jstring FakeJvm::newString(const char *utf) {
+    return reinterpret_cast<jstring>(allocString(utf));
+}
+
+void FakeJvm::releaseString(jstring string) {
+    release(reinterpret_cast<StringSlot *>(string));
+}
+
+const char *FakeJvm::staticField(const char *className, const char *fieldName) const {
+    for (int i = 0; i < fieldCount; i++) {
+        const FieldSlot &field = fields[i];
+        if (strcmp(field.className, className) == 0 && strcmp(field.name, fieldName) == 0) {
+            return field.value ? field.value->utf : nullptr;
+        }
+    }
+    return nullptr;
+}
+
+FakeJvm::StringSlot *FakeJvm::allocString(const char *utf) {
+    if (!utf || strlen(utf) >= sizeof(StringSlot::utf)) return nullptr;
+    for (StringSlot &slot : strings) {
+        if (slot.refs == 0) {
+            slot.refs = 1;
+            strcpy(slot.utf, utf);
+            return &slot;
+        }
+    }
+    return nullptr;
+}
+
+void FakeJvm::release(StringSlot *slot) {
+    if (slot && slot->refs > 0) slot->refs--;
+}
+
+jclass FakeJvm::classFor(const char *className) {
+    if (strcmp(className, BUILD_CLASS) == 0) return &buildClassTag;
+    if (strcmp(className, VERSION_CLASS) == 0) return &versionClassTag;
+    return nullptr;
+}
+
+const char *FakeJvm::classNameOf(jclass clazz) const {
+    if (clazz == &buildClassTag) return BUILD_CLASS;
+    if (clazz == &versionClassTag) return VERSION_CLASS;
+    return nullptr;
+}
@@ -0,0 +1,104 @@
+#pragma once
+
+#include <jni.h>
+
+// Every JNIEnv function the fake implements
+#define FAKE_JNI_FUNCTIONS(X) \
+    X(FindClass) \
+    X(ExceptionOccurred) \
+    X(ExceptionClear) \
+    X(DeleteLocalRef) \
+    X(GetStaticFieldID) \
+    X(GetStaticObjectField) \
+    X(SetStaticObjectField) \
+    X(NewStringUTF) \
+    X(GetStringLength) \
+    X(GetStringUTFLength) \
+    X(GetStringUTFChars) \
+    X(ReleaseStringUTFChars) \
+    X(GetStringUTFRegion) \
+    X(ExceptionCheck)
+
+enum class JniFunction {
+#define FAKE_JNI_FUNCTION_ID(name) name,
+    FAKE_JNI_FUNCTIONS(FAKE_JNI_FUNCTION_ID)
+#undef FAKE_JNI_FUNCTION_ID
+    COUNT,
+};
+
+// Calls per JNIEnv function, as made through the function table
+struct JniCallCounts {
+    int calls[static_cast<int>(JniFunction::COUNT)];
+
+    int operator[](JniFunction function) const { return calls[static_cast<int>(function)]; }
+    int total() const;
+
+    static const char *name(JniFunction function);
+};
+
+// Minimal JVM behind a real JNIEnv function table. It knows the two
+// android.os.Build classes and their String fields; strings live in a fixed
+// pool so the fake itself never allocates while the module runs.
+class FakeJvm {
+public:
+    FakeJvm();
+    FakeJvm(const FakeJvm &) = delete;
+    FakeJvm &operator=(const FakeJvm &) = delete;
+
+    JNIEnv *env() { return &env_; }
+
+    // A string owned by the caller, e.g. for AppSpecializeArgs
+    jstring newString(const char *utf);
+    void releaseString(jstring string);
+
+    // Current value of a static String field, nullptr if unset or unknown
+    const char *staticField(const char *className, const char *fieldName) const;
+
+    // Local references handed out and not deleted yet
+    int liveLocalRefs() const { return localRefs; }
+
+    // Calls made through env() since construction or resetCallCounts()
+    const JniCallCounts &callCounts() const { return calls; }
+    void resetCallCounts();
+
+    // Forgets every field write and string
+    void reset();
+
+    static FakeJvm *from(JNIEnv *env) { return reinterpret_cast<FakeJvm *>(env); }
+
+    // from() that also counts the call
+    static FakeJvm *called(JNIEnv *env, JniFunction function) {
+        FakeJvm *jvm = from(env);
+        jvm->calls.calls[static_cast<int>(function)]++;
+        return jvm;
+    }
+
+private:
+    struct StringSlot {
+        int refs;
+        char utf[512];  // Longest package name plus a process suffix
+    };
+
+    struct FieldSlot {
+        const char *className;
+        const char *name;
+        StringSlot *value;
+    };
+
+    static constexpr int MAX_STRINGS = 256;
+
+    JNIEnv env_;  // Must stay first, see from()
+    bool pendingException;
+    int localRefs;
+    JniCallCounts calls;
+    StringSlot strings[MAX_STRINGS];
+    FieldSlot fields[16];
+    int fieldCount;
+
+    StringSlot *allocString(const char *utf);
+    static void release(StringSlot *slot);
+    jclass classFor(const char *className);
+    const char *classNameOf(jclass clazz) const;
+
+    friend struct FakeJniFunctions;
+};
@@ -0,0 +1,434 @@
+#include <dlfcn.h>
+#include <elf.h>
+#include <fcntl.h>
+#include <link.h>
+#include <signal.h>
+#include <sys/mman.h>
+#include <sys/prctl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include <climits>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+#include "fake_zygisk.hpp"
+
+// -----------------------------------------------------------
+// Specialization argument layouts
+//
+// zygisk::AppSpecializeArgs cannot be constructed by design; Zygisk builds
+// a layout-compatible struct of references and passes that instead.
+// -----------------------------------------------------------
+namespace {
+
+struct HostAppSpecializeArgs {
+    jint &uid;
+    jint &gid;
+    jintArray &gids;
+    jint &runtime_flags;
+    jobjectArray &rlimits;
+    jint &mount_external;
+    jstring &se_info;
+    jstring &nice_name;
+    jstring &instruction_set;
+    jstring &app_data_dir;
+
+    jintArray *const fds_to_ignore = nullptr;
+    jboolean *const is_child_zygote = nullptr;
+    jboolean *const is_top_app = nullptr;
+    jobjectArray *const pkg_data_info_list = nullptr;
+    jobjectArray *const whitelisted_data_info_list = nullptr;
+    jboolean *const mount_data_dirs = nullptr;
+    jboolean *const mount_storage_dirs = nullptr;
+};
+
+struct HostServerSpecializeArgs {
+    jint &uid;
+    jint &gid;
+    jintArray &gids;
+    jint &runtime_flags;
+    jlong &permitted_capabilities;
+    jlong &effective_capabilities;
+};
+
+static_assert(sizeof(HostAppSpecializeArgs) == sizeof(zygisk::AppSpecializeArgs));
+static_assert(sizeof(HostServerSpecializeArgs) == sizeof(zygisk::ServerSpecializeArgs));
+
+using ModuleEntry = void (*)(zygisk::internal::api_table *, JNIEnv *);
+using CompanionEntry = void (*)(int);
+
+} // namespace
+
+// -----------------------------------------------------------
+// Companion daemon
+// -----------------------------------------------------------
+[[noreturn]] static void serveCompanion(int listener, const char *modulePath) {
+    prctl(PR_SET_PDEATHSIG, SIGKILL);
+
+    void *module = dlopen(modulePath, RTLD_NOW);
+    auto entry = module ? reinterpret_cast<CompanionEntry>(dlsym(module, "zygisk_companion_entry")) : nullptr;
+    if (!entry) {
+        fprintf(stderr, "companion: cannot load %s: %s\n", modulePath, dlerror());
+        _exit(1);
+    }
+
+    for (;;) {
+        int client = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+        if (client < 0) continue;
+        std::thread([entry, client] {
+            entry(client);
+            close(client);
+        }).detach();
+    }
+}
+
+bool FakeCompanionDaemon::start(const char *modulePath) {
+    stop();
+
+    // Abstract socket, unique per test process
+    address = {};
+    address.sun_family = AF_UNIX;
+    int length = snprintf(address.sun_path + 1, sizeof(address.sun_path) - 1, "copg-companion-%d", getpid());
+    addressLength = static_cast<socklen_t>(offsetof(sockaddr_un, sun_path) + 1 + length);
+
+    // Listen before forking so connect() can never race the child
+    int listener = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listener < 0 ||
+        bind(listener, reinterpret_cast<sockaddr *>(&address), addressLength) != 0 ||
+        listen(listener, 512) != 0) {
+        perror("companion socket");
+        if (listener >= 0) close(listener);
+        return false;
+    }
+
+    pid = fork();
+    if (pid == 0) serveCompanion(listener, modulePath);
+    close(listener);
+    return pid > 0;
+}
+
+void FakeCompanionDaemon::stop() {
+    if (pid <= 0) return;
+    kill(pid, SIGKILL);
+    waitpid(pid, nullptr, 0);
+    pid = -1;
+}
+
+int FakeCompanionDaemon::connect() const {
+    if (pid <= 0) return -1;
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0) return -1;
+    if (::connect(fd, reinterpret_cast<const sockaddr *>(&address), addressLength) != 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+// -----------------------------------------------------------
+// GOT patching
+//
+// What lsplt does on device, for the libraries a test opts in to: every
+// JUMP_SLOT and GLOB_DAT relocation binding the symbol gets the
+// replacement written to its slot.
+// -----------------------------------------------------------
+#if defined(__x86_64__)
+static constexpr uint32_t RELOC_JUMP_SLOT = R_X86_64_JUMP_SLOT;
+static constexpr uint32_t RELOC_GLOB_DAT = R_X86_64_GLOB_DAT;
+#elif defined(__aarch64__)
+static constexpr uint32_t RELOC_JUMP_SLOT = R_AARCH64_JUMP_SLOT;
+static constexpr uint32_t RELOC_GLOB_DAT = R_AARCH64_GLOB_DAT;
+#else
+#error "GOT patching is only implemented for x86_64 and aarch64 hosts"
+#endif
+
+namespace {
+
+struct GotSearch {
+    dev_t dev;
+    ino_t inode;
+    const char *symbol;
+    std::vector<void **> slots;
+};
+
+int findGotSlots(dl_phdr_info *info, size_t, void *data) {
+    auto &search = *static_cast<GotSearch *>(data);
+    struct stat file{};
+    if (!info->dlpi_name[0] || stat(info->dlpi_name, &file) != 0 || file.st_dev != search.dev ||
+        file.st_ino != search.inode) {
+        return 0;
+    }
+
+    const ElfW(Dyn) *dynamic = nullptr;
+    for (int i = 0; i < info->dlpi_phnum; i++) {
+        if (info->dlpi_phdr[i].p_type == PT_DYNAMIC) {
+            dynamic = reinterpret_cast<const ElfW(Dyn) *>(info->dlpi_addr + info->dlpi_phdr[i].p_vaddr);
+        }
+    }
+    if (!dynamic) return 1;
+
+    // The loader may or may not have relocated the dynamic section in place
+    auto address = [&](ElfW(Addr) value) { return value < info->dlpi_addr ? value + info->dlpi_addr : value; };
+    const ElfW(Sym) *symbols = nullptr;
+    const char *names = nullptr;
+    const ElfW(Rela) *tables[2] = {};
+    size_t sizes[2] = {};
+    for (const ElfW(Dyn) *entry = dynamic; entry->d_tag != DT_NULL; entry++) {
+        switch (entry->d_tag) {
+            case DT_SYMTAB: symbols = reinterpret_cast<const ElfW(Sym) *>(address(entry->d_un.d_ptr)); break;
+            case DT_STRTAB: names = reinterpret_cast<const char *>(address(entry->d_un.d_ptr)); break;
+            case DT_JMPREL: tables[0] = reinterpret_cast<const ElfW(Rela) *>(address(entry->d_un.d_ptr)); break;
+            case DT_PLTRELSZ: sizes[0] = entry->d_un.d_val; break;
+            case DT_RELA: tables[1] = reinterpret_cast<const ElfW(Rela) *>(address(entry->d_un.d_ptr)); break;
+            case DT_RELASZ: sizes[1] = entry->d_un.d_val; break;
+        }
+    }
+    if (!symbols || !names) return 1;
+
+    for (int t = 0; t < 2; t++) {
+        for (size_t i = 0; tables[t] && i < sizes[t] / sizeof(ElfW(Rela)); i++) {
+            const ElfW(Rela) &reloc = tables[t][i];
+            uint32_t type = ELF64_R_TYPE(reloc.r_info);
+            if ((type != RELOC_JUMP_SLOT && type != RELOC_GLOB_DAT) ||
+                strcmp(names + symbols[ELF64_R_SYM(reloc.r_info)].st_name, search.symbol) != 0) {
+                continue;
+            }
+            search.slots.push_back(reinterpret_cast<void **>(info->dlpi_addr + reloc.r_offset));
+        }
+    }
+    return 1;
+}
+
+} // namespace
+
+// Writable for good: RELRO pages are read-only once relocated
+static void writeGotSlot(void **slot, void *value) {
+    auto page = reinterpret_cast<uintptr_t>(slot) & ~(static_cast<uintptr_t>(getpagesize()) - 1);
+    mprotect(reinterpret_cast<void *>(page), getpagesize(), PROT_READ | PROT_WRITE);
+    *slot = value;
+}
+
+// -----------------------------------------------------------
+// Zygisk API table
+// -----------------------------------------------------------
+struct FakeZygiskApi {
+    // The PLT hook entries carry no impl pointer
+    static inline FakeZygisk *loaded = nullptr;
+
+    static FakeZygisk *self(void *impl) { return static_cast<FakeZygisk *>(impl); }
+
+    static bool registerModule(zygisk::internal::api_table *table, zygisk::internal::module_abi *abi) {
+        if (abi->api_version != ZYGISK_API_VERSION) return false;
+        self(table->impl)->abi = abi;
+        return true;
+    }
+
+    static void hookJniNativeMethods(JNIEnv *, const char *, JNINativeMethod *, int) {}
+
+    static void pltHookRegister(dev_t dev, ino_t inode, const char *symbol, void *newFunc, void **oldFunc) {
+        FakeZygisk *zygisk = loaded;
+        if (!zygisk) return;
+        if (dev != zygisk->lastHookDev || inode != zygisk->lastHookInode) zygisk->pltHookLibraries++;
+        zygisk->lastHookDev = dev;
+        zygisk->lastHookInode = inode;
+        zygisk->pendingPltHooks.push_back({symbol, newFunc, oldFunc, dev, inode});
+    }
+
+    static bool exemptFd(int fd) {
+        FakeZygisk *zygisk = loaded;
+        if (!zygisk || fd < 0) return false;
+        zygisk->exemptedFds++;
+        return true;
+    }
+
+    // Every registration gets the real function as its original, left
+    // alone when there is none, as lsplt does for a symbol the library does
+    // not import. The first one per symbol becomes the hook tests call.
+    static bool pltHookCommit() {
+        FakeZygisk *zygisk = loaded;
+        if (!zygisk) return false;
+        for (auto &hook : zygisk->pendingPltHooks) {
+            void *real = dlsym(RTLD_DEFAULT, hook.symbol.c_str());
+            if (zygisk->patches(hook.dev, hook.inode)) {
+                GotSearch search{hook.dev, hook.inode, hook.symbol.c_str(), {}};
+                dl_iterate_phdr(findGotSlots, &search);
+                for (void **slot : search.slots) {
+                    if (!real) real = *slot;
+                    zygisk->gotPatches.push_back({slot, *slot, hook.replacement});
+                    writeGotSlot(slot, hook.replacement);
+                }
+            }
+            if (hook.original && real) *hook.original = real;
+            if (!zygisk->pltHook<void *>(hook.symbol.c_str())) zygisk->pltHooks.push_back(hook);
+        }
+        zygisk->pendingPltHooks.clear();
+        return true;
+    }
+
+    static int connectCompanion(void *impl) {
+        FakeZygisk *zygisk = self(impl);
+        zygisk->companionConnections++;
+        return zygisk->companion ? zygisk->companion->connect() : -1;
+    }
+
+    static void setOption(void *impl, zygisk::Option option) {
+        switch (option) {
+            case zygisk::FORCE_DENYLIST_UNMOUNT:
+                self(impl)->denylistUnmount = true;
+                break;
+            case zygisk::DLCLOSE_MODULE_LIBRARY:
+                self(impl)->dlcloseRequested = true;
+                break;
+        }
+    }
+
+    static int getModuleDir(void *) {
+        return open(MODULE_DIR, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    }
+
+    static uint32_t getFlags(void *) { return 0; }
+};
+
+// -----------------------------------------------------------
+// Zygisk
+// -----------------------------------------------------------
+FakeZygisk::FakeZygisk(FakeJvm &jvm, const FakeCompanionDaemon *companion)
+    : jvm(jvm), companion(companion) {
+    table.impl = this;
+    table.registerModule = FakeZygiskApi::registerModule;
+    table.hookJniNativeMethods = FakeZygiskApi::hookJniNativeMethods;
+    table.pltHookRegister = FakeZygiskApi::pltHookRegister;
+    table.exemptFd = FakeZygiskApi::exemptFd;
+    table.pltHookCommit = FakeZygiskApi::pltHookCommit;
+    table.connectCompanion = FakeZygiskApi::connectCompanion;
+    table.setOption = FakeZygiskApi::setOption;
+    table.getModuleDir = FakeZygiskApi::getModuleDir;
+    table.getFlags = FakeZygiskApi::getFlags;
+}
+
+bool FakeZygisk::patchPlt(const char *path) {
+    struct stat file{};
+    if (stat(path, &file) != 0) return false;
+    patchedLibraries.push_back({file.st_dev, file.st_ino});
+    return true;
+}
+
+bool FakeZygisk::patches(dev_t dev, ino_t inode) const {
+    for (const auto &library : patchedLibraries) {
+        if (library.dev == dev && library.inode == inode) return true;
+    }
+    return false;
+}
+
+bool FakeZygisk::load(const char *modulePath) {
+    unload();
+    dlcloseRequested = false;
+    denylistUnmount = false;
+    companionConnections = 0;
+    exemptedFds = 0;
+    pltHookLibraries = 0;
+    lastHookDev = 0;
+    lastHookInode = 0;
+
+    handle = dlopen(modulePath, RTLD_NOW | RTLD_LOCAL);
+    if (!handle) {
+        fprintf(stderr, "zygisk: cannot load %s: %s\n", modulePath, dlerror());
+        return false;
+    }
+    auto entry = reinterpret_cast<ModuleEntry>(dlsym(handle, "zygisk_module_entry"));
+    if (!entry) {
+        unload();
+        return false;
+    }
+    FakeZygiskApi::loaded = this;
+    entry(&table, jvm.env());
+    return abi != nullptr;
+}
+
+void FakeZygisk::preAppSpecialize(const AppProcess &process) {
+    uid = process.uid;
+    gid = process.uid;
+    niceName = process.niceName ? jvm.newString(process.niceName) : nullptr;
+    appDataDir = process.appDataDir ? jvm.newString(process.appDataDir) : nullptr;
+
+    HostAppSpecializeArgs args{uid, gid, gids, runtimeFlags, rlimits, mountExternal,
+                               seInfo, niceName, instructionSet, appDataDir};
+    abi->preAppSpecialize(abi->impl, reinterpret_cast<zygisk::AppSpecializeArgs *>(&args));
+}
+
+void FakeZygisk::postAppSpecialize() {
+    HostAppSpecializeArgs args{uid, gid, gids, runtimeFlags, rlimits, mountExternal,
+                               seInfo, niceName, instructionSet, appDataDir};
+    abi->postAppSpecialize(abi->impl, reinterpret_cast<const zygisk::AppSpecializeArgs *>(&args));
+}
+
+void FakeZygisk::preServerSpecialize() {
+    uid = 1000;
+    gid = 1000;
+    HostServerSpecializeArgs args{uid, gid, gids, runtimeFlags,
+                                  permittedCapabilities, effectiveCapabilities};
+    abi->preServerSpecialize(abi->impl, reinterpret_cast<zygisk::ServerSpecializeArgs *>(&args));
+}
+
+void FakeZygisk::unload() {
+    // No slot may point into the module once it is gone. Slots of a
+    // library unloaded since, or patched again after a reload, are left be.
+    for (auto patch = gotPatches.rbegin(); patch != gotPatches.rend(); ++patch) {
+        Dl_info info{};
+        if (dladdr(patch->slot, &info) && *patch->slot == patch->replacement) {
+            writeGotSlot(patch->slot, patch->previous);
+        }
+    }
+    gotPatches.clear();
+    if (handle) dlclose(handle);
+    handle = nullptr;
+    abi = nullptr;
+    pendingPltHooks.clear();
+    pltHooks.clear();
+    if (FakeZygiskApi::loaded == this) FakeZygiskApi::loaded = nullptr;
+
+    jvm.releaseString(niceName);
+    jvm.releaseString(appDataDir);
+    niceName = nullptr;
+    appDataDir = nullptr;
+}
+
+bool FakeZygisk::runApp(const AppProcess &process) {
+    if (!load()) return false;
+    preAppSpecialize(process);
+    postAppSpecialize();
+    unload();
+    return true;
+}
+
+bool isMapped(const char *path) {
+    char resolved[PATH_MAX];
+    if (!realpath(path, resolved)) return false;
+
+    // Scanned in chunks from a raw fd so the check itself stays off the heap
+    int fd = open("/proc/self/maps", O_RDONLY | O_CLOEXEC);
+    if (fd < 0) return false;
+
+    char buffer[8192];
+    size_t keep = 0;
+    size_t needle = strlen(resolved);
+    bool found = false;
+    for (;;) {
+        ssize_t n = read(fd, buffer + keep, sizeof(buffer) - keep - 1);
+        if (n <= 0) break;
+        size_t length = keep + n;
+        buffer[length] = '\0';
+        if (strstr(buffer, resolved)) {
+            found = true;
+            break;
+        }
+        keep = length < needle ? length : needle;
+        memmove(buffer, buffer + length - keep, keep);
+    }
+    close(fd);
+    return found;
+}
@@ -0,0 +1,135 @@
+#pragma once
+
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+#include <string>
+#include <vector>
+
+#include "zygisk.hpp"
+#include "fake_jni.hpp"
+
+// What zygote would be specializing
+struct AppProcess {
+    int uid;
+    const char *niceName;
+    const char *appDataDir;
+};
+
+// Stand-in for the root companion daemon: a forked process that loads the
+// module and serves every connectCompanion() on its own thread, just like
+// zygiskd does.
+class FakeCompanionDaemon {
+public:
+    FakeCompanionDaemon() = default;
+    FakeCompanionDaemon(const FakeCompanionDaemon &) = delete;
+    FakeCompanionDaemon &operator=(const FakeCompanionDaemon &) = delete;
+    ~FakeCompanionDaemon() { stop(); }
+
+    // Must be called before the caller starts any thread
+    bool start(const char *modulePath = COPG_HOST_MODULE_PATH);
+    void stop();
+
+    // A connected socket, or -1
+    int connect() const;
+
+private:
+    pid_t pid = -1;
+    sockaddr_un address{};
+    socklen_t addressLength = 0;
+};
+
+// Stand-in for Zygisk inside one app process: loads the module, drives the
+// specialization callbacks through the real module ABI and records every
+// API request the module makes.
+class FakeZygisk {
+public:
+    FakeZygisk(FakeJvm &jvm, const FakeCompanionDaemon *companion);
+    FakeZygisk(const FakeZygisk &) = delete;
+    FakeZygisk &operator=(const FakeZygisk &) = delete;
+    ~FakeZygisk() { unload(); }
+
+    // dlopen + zygisk_module_entry, like a freshly forked process
+    bool load(const char *modulePath = COPG_HOST_MODULE_PATH);
+    void preAppSpecialize(const AppProcess &process);
+    void postAppSpecialize();
+    void preServerSpecialize();
+    void unload();
+
+    // load, pre, post and unload in one go
+    bool runApp(const AppProcess &process);
+
+    bool isLoaded() const { return handle != nullptr; }
+
+    // Commits patch the GOT of the library at path for real, until unload.
+    // Every other library is only recorded: tests call the replacement in
+    // place of the symbol.
+    bool patchPlt(const char *path);
+
+    // Replacement committed for symbol, or nullptr
+    template <class Fn>
+    Fn pltHook(const char *symbol) const {
+        for (const auto &hook : pltHooks) {
+            if (hook.symbol == symbol) return reinterpret_cast<Fn>(hook.replacement);
+        }
+        return nullptr;
+    }
+
+    // Requests recorded since the last load()
+    bool dlcloseRequested = false;
+    bool denylistUnmount = false;
+    int companionConnections = 0;
+    int exemptedFds = 0;
+    int pltHookLibraries = 0;  // Distinct libraries with hooks registered
+
+private:
+    FakeJvm &jvm;
+    const FakeCompanionDaemon *companion;
+    void *handle = nullptr;
+    zygisk::internal::api_table table{};
+    zygisk::internal::module_abi *abi = nullptr;
+
+    // Backing storage for the specialization arguments
+    jint uid = 0;
+    jint gid = 0;
+    jintArray gids = nullptr;
+    jint runtimeFlags = 0;
+    jobjectArray rlimits = nullptr;
+    jint mountExternal = 0;
+    jstring seInfo = nullptr;
+    jstring niceName = nullptr;
+    jstring instructionSet = nullptr;
+    jstring appDataDir = nullptr;
+    jlong permittedCapabilities = 0;
+    jlong effectiveCapabilities = 0;
+
+    struct PltHook {
+        std::string symbol;
+        void *replacement;
+        void **original;
+        dev_t dev;
+        ino_t inode;
+    };
+    struct Library {
+        dev_t dev;
+        ino_t inode;
+    };
+    struct GotPatch {
+        void **slot;
+        void *previous;
+        void *replacement;
+    };
+    std::vector<PltHook> pendingPltHooks;
+    std::vector<PltHook> pltHooks;
+    std::vector<Library> patchedLibraries;
+    std::vector<GotPatch> gotPatches;
+
+    bool patches(dev_t dev, ino_t inode) const;
+    dev_t lastHookDev = 0;
+    ino_t lastHookInode = 0;
+
+    friend struct FakeZygiskApi;
+};
+
+// True while a file with this path is mapped into the current process
+bool isMapped(const char *path);
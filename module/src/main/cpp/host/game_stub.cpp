@@ -0,0 +1,19 @@
+// Stand-in for a game engine library, loaded only after specialization: it
+// reaches the GL driver and the file system through a PLT of its own
+
+#include <fcntl.h>
+#include <cstdio>
+
+extern "C" const unsigned char *glGetString(unsigned int name);
+
+extern "C" const char *gameRenderer() {
+    return reinterpret_cast<const char *>(glGetString(0x1F01));  // GL_RENDERER
+}
+
+extern "C" int gameOpen(const char *path) {
+    return open(path, O_RDONLY | O_CLOEXEC);
+}
+
+extern "C" FILE *gameFopen(const char *path) {
+    return fopen(path, "re");
+}
@@ -0,0 +1,172 @@
+#include <cstdarg>
+#include <cstdio>
+
+#include "generator.hpp"
+#include "module_files.hpp"
+#include "protocol.hpp"
+
+namespace {
+
+struct DeviceTemplate {
+    const char *brand;
+    const char *manufacturer;
+    const char *model;
+    const char *device;
+    const char *board;
+    const char *hardware;
+};
+
+constexpr DeviceTemplate DEVICES[] = {
+    {"samsung", "samsung", "SM-S928B", "e3q", "pineapple", "qcom"},
+    {"google", "Google", "Pixel 8 Pro", "husky", "husky", "husky"},
+    {"OnePlus", "OnePlus", "CPH2581", "OP5929L1", "pineapple", "qcom"},
+    {"Xiaomi", "Xiaomi", "23127PN0CG", "shennong", "pineapple", "qcom"},
+    {"asus", "asus", "ASUS_AI2401", "AI2401", "pineapple", "qcom"},
+    {"nubia", "nubia", "NX769J", "NX769J", "kalama", "qcom"},
+    {"Lenovo", "Lenovo", "TB-9707F", "TB9707F", "kona", "qcom"},
+    {"blackshark", "blackshark", "SHARK PAR-H0", "PAR", "kona", "qcom"},
+};
+
+constexpr const char *VENDORS[] = {
+    "com.facebook", "com.tencent", "com.mihoyo", "com.activision",
+    "com.garena", "com.supercell", "com.netease", "com.pubg",
+};
+
+constexpr int DEVICE_COUNT = sizeof(DEVICES) / sizeof(DEVICES[0]);
+constexpr int VENDOR_COUNT = sizeof(VENDORS) / sizeof(VENDORS[0]);
+
+// splitmix64, good enough for reproducible test data
+uint64_t nextRandom(uint64_t &state) {
+    uint64_t z = (state += 0x9e3779b97f4a7c15ull);
+    z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ull;
+    z = (z ^ (z >> 27)) * 0x94d049bb133111ebull;
+    return z ^ (z >> 31);
+}
+
+double nextUnit(uint64_t &state) {
+    return static_cast<double>(nextRandom(state) >> 11) / static_cast<double>(1ull << 53);
+}
+
+void appendf(std::string &out, const char *format, ...) __attribute__((format(printf, 2, 3)));
+
+void appendf(std::string &out, const char *format, ...) {
+    char buffer[512];
+    va_list args;
+    va_start(args, format);
+    int length = vsnprintf(buffer, sizeof(buffer), format, args);
+    va_end(args);
+    if (length > 0) out.append(buffer, length < static_cast<int>(sizeof(buffer)) ? length : sizeof(buffer) - 1);
+}
+
+} // namespace
+
+ConfigGenerator::ConfigGenerator(const GeneratorOptions &options)
+    : options(options),
+      plain(options.plainPackages < 0 ? options.groups * options.packagesPerGroup : options.plainPackages) {}
+
+// Targeted packages come first, group by group; plain packages follow and
+// reuse the same vendor prefixes
+std::string ConfigGenerator::packageName(int index) const {
+    char name[96];
+    if (index < targetedPackages()) {
+        int group = index / options.packagesPerGroup;
+        snprintf(name, sizeof(name), "%s.rvx%d.game%d",
+                 VENDORS[group % VENDOR_COUNT], group, index % options.packagesPerGroup);
+    } else {
+        int plainIndex = index - targetedPackages();
+        int group = plainIndex / options.packagesPerGroup;
+        snprintf(name, sizeof(name), "%s.rvx%d.lite%d",
+                 VENDORS[group % VENDOR_COUNT], group, plainIndex % options.packagesPerGroup);
+    }
+    return name;
+}
+
+std::string ConfigGenerator::config() const {
+    uint64_t random = options.seed;
+    std::string out;
+    if (options.comments) {
+        appendf(out, "// Generated: %d groups x %d packages\n", options.groups, options.packagesPerGroup);
+    }
+    out += "{\n";
+
+    for (int group = 0; group < options.groups; group++) {
+        const DeviceTemplate &device = DEVICES[nextRandom(random) % DEVICE_COUNT];
+        bool extended = nextUnit(random) < options.extendedRatio;
+
+        if (options.comments) appendf(out, "  // %s %s\n", device.brand, device.model);
+        appendf(out, "  \"PACKAGES_GEN_%05d\": [", group);
+        for (int i = 0; i < options.packagesPerGroup; i++) {
+            appendf(out, "%s\"%s\"", i ? ", " : "",
+                    packageName(group * options.packagesPerGroup + i).c_str());
+        }
+        out += "],\n";
+
+        appendf(out, "  \"PACKAGES_GEN_%05d_DEVICE\": {\n", group);
+        if (options.comments) out += "    /* spoofed identity */\n";
+        appendf(out, "    \"BRAND\": \"%s\",\n", device.brand);
+        appendf(out, "    \"DEVICE\": \"%s\",\n", device.device);
+        appendf(out, "    \"MANUFACTURER\": \"%s\",\n", device.manufacturer);
+        appendf(out, "    \"MODEL\": \"%s\",\n", device.model);
+        appendf(out, "    \"FINGERPRINT\": \"%s/%s/%s:14/UP1A.%06d.001/%u:user/release-keys\",\n",
+                device.brand, device.device, device.device, 231000 + group,
+                static_cast<unsigned>(nextRandom(random) % 100000000u));
+        appendf(out, "    \"PRODUCT\": \"%s\"", device.device);
+        if (extended) {
+            appendf(out, ",\n    \"BOARD\": \"%s\",\n    \"HARDWARE\": \"%s\",\n    \"SERIAL\": \"%012llx\"",
+                    device.board, device.hardware,
+                    static_cast<unsigned long long>(nextRandom(random) & 0xffffffffffffull));
+        }
+        appendf(out, "\n  }%s\n", group + 1 < options.groups ? "," : "");
+    }
+
+    out += "}\n";
+    return out;
+}
+
+std::string ConfigGenerator::packagesList() const {
+    std::string out;
+    for (int i = 0; i < targetedPackages() + plain; i++) {
+        std::string name = packageName(i);
+        appendf(out, "%s %d 0 /data/user/0/%s default:targetSdkVersion=34 3003\n",
+                name.c_str(), static_cast<int>(AID_APP_START) + i, name.c_str());
+    }
+    return out;
+}
+
+std::vector<GeneratedLaunch> ConfigGenerator::trace(int count, double hitRatio, int users,
+                                                    uint64_t seed) const {
+    std::vector<GeneratedLaunch> launches;
+    launches.reserve(count);
+    uint64_t random = seed;
+    int targeted = targetedPackages();
+    if (targeted + plain == 0) return launches;
+    for (int i = 0; i < count; i++) {
+        bool hit = plain == 0 || (targeted > 0 && nextUnit(random) < hitRatio);
+        int index = static_cast<int>(nextRandom(random) % (hit ? targeted : plain));
+        int appId = static_cast<int>(AID_APP_START) + (hit ? index : targeted + index);
+        int userId = users > 1 ? static_cast<int>(nextRandom(random) % users) : 0;
+        launches.push_back({userId * AID_USER_OFFSET + appId, hit});
+    }
+    return launches;
+}
+
+std::string ConfigGenerator::formatTrace(const std::vector<GeneratedLaunch> &launches) {
+    std::string out;
+    for (const auto &launch : launches) {
+        appendf(out, "%d %d\n", launch.uid, launch.targeted ? 1 : 0);
+    }
+    return out;
+}
+
+bool ConfigGenerator::writeModuleFiles() const {
+    std::string configText = config();
+    std::string packagesText = packagesList();
+    return ModuleFiles::prepare() &&
+           ModuleFiles::write("config.json", configText.data(), configText.size()) &&
+           ModuleFiles::write("packages.list", packagesText.data(), packagesText.size());
+}
+
+void ConfigGenerator::removeModuleFiles() {
+    ModuleFiles::remove("config.json");
+    ModuleFiles::remove("packages.list");
+}
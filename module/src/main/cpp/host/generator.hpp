@@ -0,0 +1,63 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+// Shape of a generated module setup
+struct GeneratorOptions {
+    int groups = 30;
+    int packagesPerGroup = 16;
+
+    // Installed but never configured; -1 installs as many as are targeted
+    int plainPackages = -1;
+
+    // Share of device profiles that also set BOARD, HARDWARE and SERIAL
+    double extendedRatio = 0.5;
+
+    // Line and block comments, which the companion parser skips
+    bool comments = true;
+
+    uint64_t seed = 1;
+};
+
+// One app start in a replayed launch sequence
+struct GeneratedLaunch {
+    int uid;
+    bool targeted;
+};
+
+// Produces config.json, the matching packages.list and launch traces at
+// production scale. Package names share vendor prefixes the way real game
+// catalogues do (com.facebook.rvx12.game3, com.tencent.rvx13.game0, ...),
+// device profiles are drawn from real flagship values, and every output is
+// a pure function of the options.
+class ConfigGenerator {
+public:
+    explicit ConfigGenerator(const GeneratorOptions &options);
+
+    int targetedPackages() const { return options.groups * options.packagesPerGroup; }
+    int plainPackages() const { return plain; }
+
+    std::string config() const;
+    std::string packagesList() const;
+
+    // count launches spread over users; hitRatio of them start a targeted app.
+    // A side without packages is never drawn, and with none at all the
+    // trace is empty
+    std::vector<GeneratedLaunch> trace(int count, double hitRatio, int users = 1,
+                                       uint64_t seed = 0x9e3779b97f4a7c15ull) const;
+
+    // One "<uid> <targeted>" line per launch
+    static std::string formatTrace(const std::vector<GeneratedLaunch> &launches);
+
+    // config.json and packages.list below the host MODULE_DIR
+    bool writeModuleFiles() const;
+    static void removeModuleFiles();
+
+private:
+    GeneratorOptions options;
+    int plain;
+
+    std::string packageName(int index) const;
+};
@@ -0,0 +1,12 @@
+// Stand-in for the driver's libGLESv2: glGetString answers with fixed
+// strings, so tests can tell hooked answers from driver ones
+
+extern "C" const unsigned char *glGetString(unsigned int name) {
+    const char *value = nullptr;
+    switch (name) {
+        case 0x1F00: value = "Stub Vendor"; break;       // GL_VENDOR
+        case 0x1F01: value = "Stub Renderer"; break;     // GL_RENDERER
+        case 0x1F02: value = "OpenGL ES 3.2 Stub"; break;  // GL_VERSION
+    }
+    return reinterpret_cast<const unsigned char *>(value);
+}
@@ -0,0 +1,102 @@
+#pragma once
+
+// Host stand-in for the NDK <jni.h>. Only the types and the slice of the
+// function table that the module touches are declared; the table itself is
+// provided by the fake JVM in fake_jni.cpp.
+
+#include <cstdarg>
+#include <cstdint>
+
+typedef uint8_t jboolean;
+typedef int8_t jbyte;
+typedef uint16_t jchar;
+typedef int16_t jshort;
+typedef int32_t jint;
+typedef int64_t jlong;
+typedef float jfloat;
+typedef double jdouble;
+typedef jint jsize;
+
+class _jobject {};
+class _jclass : public _jobject {};
+class _jstring : public _jobject {};
+class _jarray : public _jobject {};
+class _jobjectArray : public _jarray {};
+class _jintArray : public _jarray {};
+class _jthrowable : public _jobject {};
+
+typedef _jobject *jobject;
+typedef _jclass *jclass;
+typedef _jstring *jstring;
+typedef _jarray *jarray;
+typedef _jobjectArray *jobjectArray;
+typedef _jintArray *jintArray;
+typedef _jthrowable *jthrowable;
+
+struct _jfieldID;
+typedef struct _jfieldID *jfieldID;
+struct _jmethodID;
+typedef struct _jmethodID *jmethodID;
+
+#define JNI_FALSE 0
+#define JNI_TRUE 1
+#define JNI_OK 0
+#define JNI_ERR (-1)
+
+typedef struct {
+    const char *name;
+    const char *signature;
+    void *fnPtr;
+} JNINativeMethod;
+
+struct _JNIEnv;
+typedef _JNIEnv JNIEnv;
+
+struct JNINativeInterface {
+    void *reserved0;
+    jclass (*FindClass)(JNIEnv *, const char *);
+    jthrowable (*ExceptionOccurred)(JNIEnv *);
+    void (*ExceptionClear)(JNIEnv *);
+    void (*DeleteLocalRef)(JNIEnv *, jobject);
+    jfieldID (*GetStaticFieldID)(JNIEnv *, jclass, const char *, const char *);
+    jobject (*GetStaticObjectField)(JNIEnv *, jclass, jfieldID);
+    void (*SetStaticObjectField)(JNIEnv *, jclass, jfieldID, jobject);
+    jstring (*NewStringUTF)(JNIEnv *, const char *);
+    jsize (*GetStringLength)(JNIEnv *, jstring);
+    jsize (*GetStringUTFLength)(JNIEnv *, jstring);
+    const char *(*GetStringUTFChars)(JNIEnv *, jstring, jboolean *);
+    void (*ReleaseStringUTFChars)(JNIEnv *, jstring, const char *);
+    void (*GetStringUTFRegion)(JNIEnv *, jstring, jsize, jsize, char *);
+    jboolean (*ExceptionCheck)(JNIEnv *);
+};
+
+struct _JNIEnv {
+    const JNINativeInterface *functions;
+
+    jclass FindClass(const char *name) { return functions->FindClass(this, name); }
+    jthrowable ExceptionOccurred() { return functions->ExceptionOccurred(this); }
+    void ExceptionClear() { functions->ExceptionClear(this); }
+    void DeleteLocalRef(jobject obj) { functions->DeleteLocalRef(this, obj); }
+    jfieldID GetStaticFieldID(jclass clazz, const char *name, const char *sig) {
+        return functions->GetStaticFieldID(this, clazz, name, sig);
+    }
+    jobject GetStaticObjectField(jclass clazz, jfieldID fieldID) {
+        return functions->GetStaticObjectField(this, clazz, fieldID);
+    }
+    void SetStaticObjectField(jclass clazz, jfieldID fieldID, jobject value) {
+        functions->SetStaticObjectField(this, clazz, fieldID, value);
+    }
+    jstring NewStringUTF(const char *bytes) { return functions->NewStringUTF(this, bytes); }
+    jsize GetStringLength(jstring string) { return functions->GetStringLength(this, string); }
+    jsize GetStringUTFLength(jstring string) { return functions->GetStringUTFLength(this, string); }
+    const char *GetStringUTFChars(jstring string, jboolean *isCopy) {
+        return functions->GetStringUTFChars(this, string, isCopy);
+    }
+    void ReleaseStringUTFChars(jstring string, const char *utf) {
+        functions->ReleaseStringUTFChars(this, string, utf);
+    }
+    void GetStringUTFRegion(jstring str, jsize start, jsize len, char *buf) {
+        functions->GetStringUTFRegion(this, str, start, len, buf);
+    }
+    jboolean ExceptionCheck() { return functions->ExceptionCheck(this); }
+};
@@ -0,0 +1,14 @@
+#pragma once
+
+// Host stand-in for bionic <sys/system_properties.h>, implemented in
+// android_stubs.cpp on top of a fixed in-memory property table
+
+#define PROP_NAME_MAX 32
+#define PROP_VALUE_MAX 92
+
+extern "C" {
+
+int __system_property_set(const char *name, const char *value);
+int __system_property_get(const char *name, char *value);
+
+}
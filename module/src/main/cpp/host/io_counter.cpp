@@ -0,0 +1,117 @@
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cstdarg>
+#include <cstdio>
+
+#include "io_counter.hpp"
+
+namespace {
+
+thread_local IoStats threadStats;
+
+template <class Fn>
+Fn next(const char *symbol) {
+    return reinterpret_cast<Fn>(dlsym(RTLD_NEXT, symbol));
+}
+
+// Resolved once per symbol, thread-safe through the static init
+#define NEXT(symbol) \
+    static const auto real = next<decltype(&::symbol)>(#symbol)
+
+template <class T>
+T count(T result, bool transfersBytes = false) {
+    threadStats.calls++;
+    if (transfersBytes && result > 0) threadStats.bytes += static_cast<uint64_t>(result);
+    return result;
+}
+
+} // namespace
+
+IoStats threadIoStats() {
+    return threadStats;
+}
+
+extern "C" {
+
+[[gnu::visibility("default")]] ssize_t read(int fd, void *buffer, size_t count) {
+    NEXT(read);
+    return ::count(real(fd, buffer, count), true);
+}
+
+[[gnu::visibility("default")]] ssize_t write(int fd, const void *buffer, size_t count) {
+    NEXT(write);
+    return ::count(real(fd, buffer, count), true);
+}
+
+[[gnu::visibility("default")]] ssize_t recv(int fd, void *buffer, size_t length, int flags) {
+    NEXT(recv);
+    return ::count(real(fd, buffer, length, flags), true);
+}
+
+[[gnu::visibility("default")]] ssize_t send(int fd, const void *buffer, size_t length, int flags) {
+    NEXT(send);
+    return ::count(real(fd, buffer, length, flags), true);
+}
+
+[[gnu::visibility("default")]] int open(const char *path, int flags, ...) {
+    NEXT(open);
+    mode_t mode = 0;
+    if (flags & (O_CREAT | O_TMPFILE)) {
+        va_list args;
+        va_start(args, flags);
+        mode = va_arg(args, mode_t);
+        va_end(args);
+    }
+    return ::count(real(path, flags, mode));
+}
+
+[[gnu::visibility("default")]] int openat(int dirfd, const char *path, int flags, ...) {
+    NEXT(openat);
+    mode_t mode = 0;
+    if (flags & (O_CREAT | O_TMPFILE)) {
+        va_list args;
+        va_start(args, flags);
+        mode = va_arg(args, mode_t);
+        va_end(args);
+    }
+    return ::count(real(dirfd, path, flags, mode));
+}
+
+[[gnu::visibility("default")]] int close(int fd) {
+    NEXT(close);
+    return ::count(real(fd));
+}
+
+[[gnu::visibility("default")]] int stat(const char *path, struct stat *st) {
+    NEXT(stat);
+    return ::count(real(path, st));
+}
+
+[[gnu::visibility("default")]] int fstat(int fd, struct stat *st) {
+    NEXT(fstat);
+    return ::count(real(fd, st));
+}
+
+[[gnu::visibility("default")]] FILE *fopen(const char *path, const char *mode) {
+    NEXT(fopen);
+    threadStats.calls++;
+    return real(path, mode);
+}
+
+[[gnu::visibility("default")]] size_t fread(void *buffer, size_t size, size_t count, FILE *file) {
+    NEXT(fread);
+    size_t items = real(buffer, size, count, file);
+    threadStats.calls++;
+    threadStats.bytes += items * size;
+    return items;
+}
+
+[[gnu::visibility("default")]] int fclose(FILE *file) {
+    NEXT(fclose);
+    return ::count(real(file));
+}
+
+}
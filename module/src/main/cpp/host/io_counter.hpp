@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+// Interposed file and socket I/O entry points. Linking io_counter.cpp into
+// an executable counts every call the process makes through them,
+// dlopen-ed libraries included. Calls libc makes internally (e.g. fread
+// refilling its buffer) do not go through the PLT and stay uncounted;
+// the stdio entry points themselves are counted instead.
+
+struct IoStats {
+    uint64_t calls;
+    uint64_t bytes;
+};
+
+// I/O made by the calling thread so far
+IoStats threadIoStats();
+
+// I/O made by the calling thread while the scope is alive
+class IoScope {
+public:
+    IoScope() : start(threadIoStats()) {}
+
+    uint64_t calls() const { return threadIoStats().calls - start.calls; }
+    uint64_t bytes() const { return threadIoStats().bytes - start.bytes; }
+
+private:
+    IoStats start;
+};
@@ -0,0 +1,62 @@
+#include <dirent.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <cerrno>
+#include <climits>
+#include <cstdio>
+#include <cstring>
+
+#include "module_files.hpp"
+
+// dir/name, then suffix, into path; false if it does not fit
+static bool joinPath(char (&path)[PATH_MAX], const char *dir, const char *name, const char *suffix = "") {
+    int length = snprintf(path, sizeof(path), "%s/%s%s", dir, name, suffix);
+    return length >= 0 && length < static_cast<int>(sizeof(path));
+}
+
+bool ModuleFiles::prepare() {
+    return mkdir(MODULE_DIR, 0755) == 0 || errno == EEXIST;
+}
+
+bool ModuleFiles::write(const char *name, const char *content, size_t length) {
+    char path[PATH_MAX];
+    char temp[PATH_MAX];
+    if (!joinPath(path, MODULE_DIR, name) || !joinPath(temp, MODULE_DIR, name, ".tmp")) return false;
+
+    // A rename gives the file a new inode, so the companion can never miss
+    // a change that happens within its timestamp granularity
+    FILE *file = fopen(temp, "wb");
+    if (!file) return false;
+    bool written = fwrite(content, 1, length, file) == length;
+    written = fclose(file) == 0 && written;
+    return written && rename(temp, path) == 0;
+}
+
+bool ModuleFiles::write(const char *name, const char *content) {
+    return write(name, content, strlen(content));
+}
+
+void ModuleFiles::remove(const char *name) {
+    char path[PATH_MAX];
+    if (joinPath(path, MODULE_DIR, name)) unlink(path);
+}
+
+bool ModuleFiles::makeDirectory(const char *name) {
+    char path[PATH_MAX];
+    if (!joinPath(path, MODULE_DIR, name)) return false;
+    return mkdir(path, 0755) == 0 || errno == EEXIST;
+}
+
+void ModuleFiles::removeDirectory(const char *name) {
+    char path[PATH_MAX];
+    if (!joinPath(path, MODULE_DIR, name)) return;
+    DIR *dir = opendir(path);
+    if (!dir) return;
+    while (dirent *entry = readdir(dir)) {
+        if (entry->d_name[0] == '.') continue;
+        char file[PATH_MAX];
+        if (joinPath(file, path, entry->d_name)) unlink(file);
+    }
+    closedir(dir);
+    rmdir(path);
+}
@@ -0,0 +1,17 @@
+#pragma once
+
+// Files below the host MODULE_DIR, where the companion looks for its inputs
+class ModuleFiles {
+public:
+    // Creates MODULE_DIR if needed
+    static bool prepare();
+
+    // Atomically replaces MODULE_DIR/<name>
+    static bool write(const char *name, const char *content, size_t length);
+    static bool write(const char *name, const char *content);
+    static void remove(const char *name);
+
+    // MODULE_DIR/<name> as a directory; removal takes its files with it
+    static bool makeDirectory(const char *name);
+    static void removeDirectory(const char *name);
+};
@@ -0,0 +1,47 @@
+#pragma once
+
+// Shared config and packages.list used across the test cases
+
+static constexpr const char *TEST_CONFIG = R"({
+  // Comments are accepted, as with parse(..., ignore_comments = true)
+  "PACKAGES_PIXEL_8_PRO": [
+    "com.game.one",
+    "com.game.work@10"
+  ],
+  "PACKAGES_PIXEL_8_PRO_DEVICE": {
+    "BRAND": "google",
+    "DEVICE": "husky",
+    "MANUFACTURER": "Google",
+    "MODEL": "Pixel 8 Pro",
+    "FINGERPRINT": "google/husky/husky:14/AP1A.240505.004/11583682:user/release-keys",
+    "PRODUCT": "husky"
+  },
+  "PACKAGES_TAB_S9": [
+    "com.game.two"
+  ],
+  "PACKAGES_TAB_S9_DEVICE": {
+    "BRAND": "samsung",
+    "DEVICE": "gts9wifi",
+    "MANUFACTURER": "samsung",
+    "MODEL": "SM-X710",
+    "FINGERPRINT": "samsung/gts9wifixx/gts9wifi:14/UP1A.231005.007/X710XXU2BXB3:user/release-keys",
+    "PRODUCT": "gts9wifixx",
+    "BOARD": "kalama",
+    "HARDWARE": "qcom"
+  }
+})";
+
+static constexpr const char *TEST_PACKAGES_LIST =
+    "com.game.one 10100 0 /data/user/0/com.game.one default:targetSdkVersion=34 3003\n"
+    "com.game.work 10101 0 /data/user/0/com.game.work default:targetSdkVersion=34 3003\n"
+    "com.game.two 10102 0 /data/user/0/com.game.two default:targetSdkVersion=34 3003\n"
+    "com.other.app 10200 0 /data/user/0/com.other.app default:targetSdkVersion=34 none\n";
+
+// ro.build.version.sdk the companion daemon starts with
+static constexpr const char *HOST_SDK_LEVEL = "34";
+
+static constexpr int UID_GAME_ONE = 10100;
+static constexpr int UID_GAME_WORK = 10101;
+static constexpr int UID_GAME_TWO = 10102;
+static constexpr int UID_OTHER_APP = 10200;
+static constexpr int SECONDARY_USER = 10 * 100000;
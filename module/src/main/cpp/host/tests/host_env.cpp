@@ -0,0 +1,38 @@
+#include <string>
+
+#include <sys/system_properties.h>
+
+#include "android_stubs.hpp"
+#include "fixtures.hpp"
+#include "host_env.hpp"
+
+static FakeCompanionDaemon companionDaemon;
+
+// The daemon keeps the properties it was forked with for all test cases
+bool HostEnv::startCompanion() {
+    __system_property_set("ro.build.version.sdk", HOST_SDK_LEVEL);
+    return ModuleFiles::prepare() && companionDaemon.start();
+}
+
+void HostEnv::stopCompanion() {
+    companionDaemon.stop();
+}
+
+const FakeCompanionDaemon *HostEnv::companion() {
+    return &companionDaemon;
+}
+
+bool HostEnv::writeFragment(const char *name, const char *json) {
+    std::string path = std::string("config.d/") + name;
+    return ModuleFiles::makeDirectory("config.d") && ModuleFiles::write(path.c_str(), json);
+}
+
+void HostEnv::reset() {
+    copg_host_properties_reset();
+    copg_host_log_reset();
+    ModuleFiles::remove("config.json");
+    ModuleFiles::remove("packages.list");
+    ModuleFiles::removeDirectory("config.d");
+    ModuleFiles::remove("trace");
+    ModuleFiles::remove("trace_marker");
+}
@@ -0,0 +1,19 @@
+#pragma once
+
+#include "fake_zygisk.hpp"
+#include "module_files.hpp"
+
+// Module directory and companion daemon shared by all test cases
+class HostEnv {
+public:
+    static bool startCompanion();
+    static void stopCompanion();
+    static const FakeCompanionDaemon *companion();
+
+    // Clears properties, log counters and module files between test cases
+    static void reset();
+
+    static bool writeConfig(const char *json) { return ModuleFiles::write("config.json", json); }
+    static bool writePackagesList(const char *text) { return ModuleFiles::write("packages.list", text); }
+    static bool writeFragment(const char *name, const char *json);
+};
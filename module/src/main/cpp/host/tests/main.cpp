@@ -0,0 +1,46 @@
+#include <cstdio>
+#include <cstring>
+
+#include "test.hpp"
+#include "host_env.hpp"
+
+static TestCase *tests;
+static int failures;
+
+void registerTest(TestCase *test) {
+    // Keep declaration order within a file
+    TestCase **tail = &tests;
+    while (*tail) tail = &(*tail)->next;
+    *tail = test;
+}
+
+void reportFailure(const char *file, int line, const char *expression) {
+    fprintf(stderr, "  %s:%d: CHECK(%s) failed\n", file, line, expression);
+    failures++;
+}
+
+// Runs every test, or only those whose name contains argv[1]
+int main(int argc, char **argv) {
+    // Forks, so it has to happen before any test starts a thread
+    if (!HostEnv::startCompanion()) {
+        fprintf(stderr, "failed to start the companion daemon\n");
+        return 1;
+    }
+
+    int run = 0;
+    int failed = 0;
+    for (TestCase *test = tests; test; test = test->next) {
+        if (argc > 1 && !strstr(test->name, argv[1])) continue;
+
+        int before = failures;
+        HostEnv::reset();
+        test->run();
+        run++;
+        if (failures != before) failed++;
+        printf("[%s] %s\n", failures == before ? "  OK  " : " FAIL ", test->name);
+    }
+
+    HostEnv::stopCompanion();
+    printf("%d tests, %d failed\n", run, failed);
+    return failed == 0 && run > 0 ? 0 : 1;
+}
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <cstdio>
+#include <cstring>
+
+// Just enough of a test framework: self-registering cases and CHECK macros
+// that report and bail out of the current case.
+
+struct TestCase {
+    const char *name;
+    void (*run)();
+    TestCase *next;
+};
+
+void registerTest(TestCase *test);
+void reportFailure(const char *file, int line, const char *expression);
+
+struct TestRegistrar {
+    TestCase test;
+    TestRegistrar(const char *name, void (*run)()) : test{name, run, nullptr} {
+        registerTest(&test);
+    }
+};
+
+#define TEST(name)                                                   \
+    static void test_##name();                                       \
+    static TestRegistrar registrar_##name(#name, test_##name);       \
+    static void test_##name()
+
+#define CHECK(condition)                                             \
+    do {                                                             \
+        if (!(condition)) {                                          \
+            reportFailure(__FILE__, __LINE__, #condition);           \
+            return;                                                  \
+        }                                                            \
+    } while (0)
+
+// Both sides compared as long long, whatever their signedness
+#define CHECK_EQ(actual, expected)                                   \
+    do {                                                             \
+        long long actual_ = static_cast<long long>(actual);          \
+        long long expected_ = static_cast<long long>(expected);      \
+        if (actual_ != expected_) {                                  \
+            fprintf(stderr, "  actual: %lld, expected: %lld\n",      \
+                    actual_, expected_);                             \
+            reportFailure(__FILE__, __LINE__, #actual " == " #expected); \
+            return;                                                  \
+        }                                                            \
+    } while (0)
+
+#define CHECK_STREQ(actual, expected)                                \
+    do {                                                             \
+        const char *actual_ = (actual);                              \
+        const char *expected_ = (expected);                          \
+        if (!actual_ || strcmp(actual_, expected_) != 0) {           \
+            fprintf(stderr, "  actual: \"%s\", expected: \"%s\"\n",  \
+                    actual_ ? actual_ : "(null)", expected_);        \
+            reportFailure(__FILE__, __LINE__, #actual " == " #expected); \
+            return;                                                  \
+        }                                                            \
+    } while (0)
@@ -0,0 +1,63 @@
+#include <android/log.h>
+#include <string>
+#include <vector>
+
+#include "android_stubs.hpp"
+#include "binlog.hpp"
+#include "fixtures.hpp"
+#include "host_env.hpp"
+#include "test.hpp"
+
+// Deferred-format debug log: encoding, formatting and where lines end up
+
+static std::vector<std::string> lines(const BinaryLog &log) {
+    std::vector<std::string> out;
+    BinaryLog::forEachLine(log.data(), log.size(), [&](const char *line) { out.emplace_back(line); });
+    return out;
+}
+
+TEST(binary_log_formats_recorded_arguments) {
+    static BinaryLog log;
+    log.reset();
+    int32_t uid = 1010100;
+    log.append(MSG_PRE_APP, uid, 10u, 10100u);
+    log.append(MSG_FIELD_SET, "MODEL", "Pixel 8 Pro");
+    log.append(MSG_SPOOFING_DONE);
+
+    auto out = lines(log);
+    CHECK_EQ(out.size(), 3u);
+    CHECK(out.size() == 3 && out[0] == "preAppSpecialize => uid = 1010100 (user 10, app 10100)");
+    CHECK(out.size() == 3 && out[1] == "Successfully set Java field 'MODEL' = 'Pixel 8 Pro'");
+    CHECK(out.size() == 3 && out[2] == "All spoofing operations completed");
+}
+
+TEST(binary_log_drops_whole_records_when_full) {
+    static BinaryLog log;
+    log.reset();
+    std::string value(300, 'v');
+    int appended = 0;
+    while (log.droppedCount() == 0) {
+        log.append(MSG_PROPERTY_SET, "ro.product.model", value.c_str());
+        appended++;
+    }
+    log.append(MSG_SPOOFING_DONE);
+
+    auto out = lines(log);
+    CHECK_EQ(out.size() + log.droppedCount(), static_cast<size_t>(appended) + 1);
+    std::string expected = "Successfully set property 'ro.product.model' = '" + std::string(255, 'v') + "'";
+    for (const auto &line : out) CHECK(line == expected);
+}
+
+TEST(app_side_debug_lines_are_deferred_to_companion) {
+    HostEnv::writeConfig(TEST_CONFIG);
+    HostEnv::writePackagesList(TEST_PACKAGES_LIST);
+    FakeJvm jvm;
+    FakeZygisk zygisk(jvm, HostEnv::companion());
+
+    zygisk.runApp({UID_GAME_ONE, nullptr, nullptr});
+    CHECK_EQ(copg_host_log_count(ANDROID_LOG_DEBUG), 0);
+
+    // Nothing to report to, so the records are formatted in-process
+    zygisk.runApp({1000, nullptr, nullptr});
+    CHECK(copg_host_log_count(ANDROID_LOG_DEBUG) > 0);
+}
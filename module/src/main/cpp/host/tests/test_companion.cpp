@@ -0,0 +1,297 @@
+#include <sys/system_properties.h>
+#include <string>
+
+#include "fixtures.hpp"
+#include "generator.hpp"
+#include "host_env.hpp"
+#include "test.hpp"
+
+// Companion-side snapshot compilation, (userId, appId) lookups and reloads
+
+static const char *spoofedModel(int uid) {
+    static FakeJvm jvm;
+    jvm.reset();
+    FakeZygisk zygisk(jvm, HostEnv::companion());
+    if (!zygisk.runApp({uid, nullptr, nullptr})) return nullptr;
+    return jvm.staticField("android/os/Build", "MODEL");
+}
+
+TEST(secondary_user_resolves_same_profile) {
+    HostEnv::writeConfig(TEST_CONFIG);
+    HostEnv::writePackagesList(TEST_PACKAGES_LIST);
+    CHECK_STREQ(spoofedModel(SECONDARY_USER + UID_GAME_ONE), "Pixel 8 Pro");
+    CHECK_STREQ(spoofedModel(SECONDARY_USER + UID_GAME_TWO), "SM-X710");
+}
+
+TEST(user_bound_entry_matches_only_its_user) {
+    HostEnv::writeConfig(TEST_CONFIG);
+    HostEnv::writePackagesList(TEST_PACKAGES_LIST);
+    CHECK(spoofedModel(UID_GAME_WORK) == nullptr);
+    CHECK_STREQ(spoofedModel(SECONDARY_USER + UID_GAME_WORK), "Pixel 8 Pro");
+}
+
+TEST(user_bound_entry_wins_over_any_user) {
+    HostEnv::writeConfig(R"({
+      "PACKAGES_A": ["com.game.one"],
+      "PACKAGES_A_DEVICE": {"MODEL": "any-user"},
+      "PACKAGES_B": ["com.game.one@10"],
+      "PACKAGES_B_DEVICE": {"MODEL": "user-10"}
+    })");
+    HostEnv::writePackagesList(TEST_PACKAGES_LIST);
+    CHECK_STREQ(spoofedModel(UID_GAME_ONE), "any-user");
+    CHECK_STREQ(spoofedModel(SECONDARY_USER + UID_GAME_ONE), "user-10");
+}
+
+TEST(shared_app_id_goes_to_the_lowest_package_name) {
+    // Four packages on one sharedUserId, listed in reverse order
+    std::string packages = TEST_PACKAGES_LIST;
+    for (const char *name : {"com.shared.delta", "com.shared.charlie", "com.shared.bravo", "com.shared.alpha"}) {
+        packages += std::string(name) + " 10300 0 /data/user/0/" + name + " default:targetSdkVersion=34 none\n";
+    }
+    HostEnv::writePackagesList(packages.c_str());
+    HostEnv::writeConfig(R"({
+      "PACKAGES_D": ["com.shared.delta"],
+      "PACKAGES_D_DEVICE": {"MODEL": "delta"},
+      "PACKAGES_C": ["com.shared.charlie"],
+      "PACKAGES_C_DEVICE": {"MODEL": "charlie"},
+      "PACKAGES_B": ["com.shared.bravo"],
+      "PACKAGES_B_DEVICE": {"MODEL": "bravo"}
+    })");
+    CHECK_STREQ(spoofedModel(10300), "bravo");
+    HostEnv::writeFragment("10-alpha.json", R"({
+      "PACKAGES_A": ["com.shared.alpha"],
+      "PACKAGES_A_DEVICE": {"MODEL": "alpha"}
+    })");
+
+    // A later file never takes the app id over, however its packages sort
+    CHECK_STREQ(spoofedModel(10300), "bravo");
+}
+
+TEST(missing_config_targets_nothing) {
+    HostEnv::writePackagesList(TEST_PACKAGES_LIST);
+    CHECK(spoofedModel(UID_GAME_ONE) == nullptr);
+}
+
+TEST(invalid_config_targets_nothing) {
+    HostEnv::writeConfig("{ \"PACKAGES_A\": [");
+    HostEnv::writePackagesList(TEST_PACKAGES_LIST);
+    CHECK(spoofedModel(UID_GAME_ONE) == nullptr);
+}
+
+TEST(oversized_value_is_dropped) {
+    std::string config = R"({"PACKAGES_A": ["com.game.one"], "PACKAGES_A_DEVICE": {"MODEL": "M", "FINGERPRINT": ")";
+    config.append(PROP_VALUE_MAX, 'x');
+    config += R"("}})";
+    HostEnv::writeConfig(config.c_str());
+    HostEnv::writePackagesList(TEST_PACKAGES_LIST);
+
+    static FakeJvm jvm;
+    jvm.reset();
+    FakeZygisk zygisk(jvm, HostEnv::companion());
+    CHECK(zygisk.runApp({UID_GAME_ONE, nullptr, nullptr}));
+    CHECK_STREQ(jvm.staticField("android/os/Build", "MODEL"), "M");
+    CHECK(jvm.staticField("android/os/Build", "FINGERPRINT") == nullptr);
+}
+
+TEST(config_change_is_picked_up) {
+    HostEnv::writeConfig(TEST_CONFIG);
+    HostEnv::writePackagesList(TEST_PACKAGES_LIST);
+    CHECK_STREQ(spoofedModel(UID_GAME_ONE), "Pixel 8 Pro");
+
+    HostEnv::writeConfig(R"({"PACKAGES_A": ["com.game.one"], "PACKAGES_A_DEVICE": {"MODEL": "changed"}})");
+    CHECK_STREQ(spoofedModel(UID_GAME_ONE), "changed");
+}
+
+TEST(new_install_is_picked_up) {
+    HostEnv::writeConfig(R"({"PACKAGES_A": ["com.game.new"], "PACKAGES_A_DEVICE": {"MODEL": "new"}})");
+    HostEnv::writePackagesList(TEST_PACKAGES_LIST);
+    CHECK(spoofedModel(10300) == nullptr);
+
+    std::string packages = TEST_PACKAGES_LIST;
+    packages += "com.game.new 10300 0 /data/user/0/com.game.new default:targetSdkVersion=34 3003\n";
+    HostEnv::writePackagesList(packages.c_str());
+    CHECK_STREQ(spoofedModel(10300), "new");
+}
+
+TEST(profile_extends_base_profiles) {
+    HostEnv::writeConfig(R"({
+      "SAMSUNG_BASE": {
+        "BRAND": "samsung",
+        "MANUFACTURER": "samsung",
+        "HARDWARE": "qcom"
+      },
+      "SAMSUNG_TAB_BASE": {
+        "extends": "SAMSUNG_BASE",
+        "DEVICE": "gts9wifi",
+        "PRODUCT": "gts9wifixx"
+      },
+      "PACKAGES_TAB": ["com.game.two"],
+      "PACKAGES_TAB_DEVICE": {
+        "extends": "SAMSUNG_TAB_BASE",
+        "MODEL": "SM-X710",
+        "HARDWARE": ""
+      },
+      "PACKAGES_PHONE": ["com.game.one"],
+      "PACKAGES_PHONE_DEVICE": {
+        "extends": "SAMSUNG_BASE",
+        "MODEL": "SM-S918B"
+      }
+    })");
+    HostEnv::writePackagesList(TEST_PACKAGES_LIST);
+
+    static FakeJvm jvm;
+    jvm.reset();
+    FakeZygisk zygisk(jvm, HostEnv::companion());
+    CHECK(zygisk.runApp({UID_GAME_TWO, nullptr, nullptr}));
+    CHECK_STREQ(jvm.staticField("android/os/Build", "BRAND"), "samsung");
+    CHECK_STREQ(jvm.staticField("android/os/Build", "DEVICE"), "gts9wifi");
+    CHECK_STREQ(jvm.staticField("android/os/Build", "MODEL"), "SM-X710");
+    // An empty string overrides the base, and empty fields are skipped
+    CHECK(jvm.staticField("android/os/Build", "HARDWARE") == nullptr);
+
+    jvm.reset();
+    CHECK(zygisk.runApp({UID_GAME_ONE, nullptr, nullptr}));
+    CHECK_STREQ(jvm.staticField("android/os/Build", "MANUFACTURER"), "samsung");
+    CHECK_STREQ(jvm.staticField("android/os/Build", "HARDWARE"), "qcom");
+    CHECK_STREQ(jvm.staticField("android/os/Build", "MODEL"), "SM-S918B");
+    CHECK(jvm.staticField("android/os/Build", "DEVICE") == nullptr);
+}
+
+TEST(package_override_gets_its_own_record) {
+    HostEnv::writeConfig(R"({
+      "PACKAGES_PIXEL": ["com.game.one", "com.game.work@10", "com.game.two"],
+      "PACKAGES_PIXEL_DEVICE": {
+        "BRAND": "google",
+        "MODEL": "Pixel 8 Pro",
+        "FINGERPRINT": "google/husky/husky:14/AP1A.240505.004/11583682:user/release-keys"
+      },
+      "PACKAGES_PIXEL_OVERRIDES": {
+        "com.game.two": {
+          "FINGERPRINT": "google/husky/husky:13/TQ3A.230901.001/10750268:user/release-keys",
+          "PROPS": {"ro.build.version.release": "13"}
+        }
+      }
+    })");
+    HostEnv::writePackagesList(TEST_PACKAGES_LIST);
+
+    static FakeJvm jvm;
+    jvm.reset();
+    FakeZygisk zygisk(jvm, HostEnv::companion());
+    CHECK(zygisk.runApp({UID_GAME_TWO, nullptr, nullptr}));
+    CHECK_STREQ(jvm.staticField("android/os/Build", "MODEL"), "Pixel 8 Pro");
+    CHECK_STREQ(jvm.staticField("android/os/Build", "FINGERPRINT"),
+                "google/husky/husky:13/TQ3A.230901.001/10750268:user/release-keys");
+    char release[PROP_VALUE_MAX];
+    __system_property_get("ro.build.version.release", release);
+    CHECK_STREQ(release, "13");
+
+    // The rest of the group keeps the group profile
+    jvm.reset();
+    CHECK(zygisk.runApp({UID_GAME_ONE, nullptr, nullptr}));
+    CHECK_STREQ(jvm.staticField("android/os/Build", "FINGERPRINT"),
+                "google/husky/husky:14/AP1A.240505.004/11583682:user/release-keys");
+}
+
+TEST(config_fragments_are_merged_after_config_json) {
+    HostEnv::writeConfig(R"({
+      "PACKAGES_PIXEL": ["com.game.one"],
+      "PACKAGES_PIXEL_DEVICE": {"MODEL": "Pixel 8 Pro"}
+    })");
+    HostEnv::writePackagesList(TEST_PACKAGES_LIST);
+    HostEnv::writeFragment("10-tab.json", R"({
+      "PACKAGES_TAB": ["com.game.two", "com.game.one"],
+      "PACKAGES_TAB_DEVICE": {"MODEL": "SM-X710"}
+    })");
+    HostEnv::writeFragment("20-broken.json", "{");
+    CHECK_STREQ(spoofedModel(UID_GAME_ONE), "Pixel 8 Pro");
+    CHECK_STREQ(spoofedModel(UID_GAME_TWO), "SM-X710");
+
+    // Editing, adding and removing fragments is picked up per file
+    HostEnv::writeFragment("10-tab.json", R"({
+      "PACKAGES_TAB": ["com.game.two"],
+      "PACKAGES_TAB_DEVICE": {"MODEL": "SM-X910"}
+    })");
+    CHECK_STREQ(spoofedModel(UID_GAME_TWO), "SM-X910");
+    HostEnv::writeFragment("30-other.json", R"({
+      "PACKAGES_OTHER": ["com.other.app"],
+      "PACKAGES_OTHER_DEVICE": {"MODEL": "other"}
+    })");
+    CHECK_STREQ(spoofedModel(UID_OTHER_APP), "other");
+    CHECK_STREQ(spoofedModel(UID_GAME_TWO), "SM-X910");
+    ModuleFiles::remove("config.d/10-tab.json");
+    CHECK(spoofedModel(UID_GAME_TWO) == nullptr);
+    CHECK_STREQ(spoofedModel(UID_GAME_ONE), "Pixel 8 Pro");
+}
+
+TEST(sdk_entries_follow_the_running_release) {
+    HostEnv::writeConfig(R"({
+      "PIXEL_BASE": {
+        "FINGERPRINT": "google/husky/husky:14/AP1A.240505.004/11583682:user/release-keys",
+        "BY_SDK": {
+          "33": {"FINGERPRINT": "google/husky/husky:13/TQ3A.230901.001/10750268:user/release-keys"},
+          "34": {"FINGERPRINT": "google/husky/husky:14/UQ1A.240205.004/11269751:user/release-keys"},
+          "35": {"FINGERPRINT": "google/husky/husky:15/AP3A.241005.015/12366759:user/release-keys"}
+        }
+      },
+      "PACKAGES_PIXEL": ["com.game.one"],
+      "PACKAGES_PIXEL_DEVICE": {"extends": "PIXEL_BASE", "MODEL": "Pixel 8 Pro"},
+      "PACKAGES_TAB": ["com.game.two"],
+      "PACKAGES_TAB_DEVICE": {
+        "MODEL": "SM-X710",
+        "BY_SDK": {"30": {"MODEL": "SM-X700"}, "31": {"MODEL": "SM-X706B", "PROPS": {"ro.soc.model": "SM8450"}},
+                   "36": {"MODEL": "SM-X920"}, "latest": {"MODEL": "SM-X999"}}
+      }
+    })");
+    HostEnv::writePackagesList(TEST_PACKAGES_LIST);
+    static FakeJvm jvm;
+    FakeZygisk zygisk(jvm, HostEnv::companion());
+
+    // The companion runs on HOST_SDK_LEVEL, an exact match is taken
+    jvm.reset();
+    CHECK(zygisk.runApp({UID_GAME_ONE, nullptr, nullptr}));
+    CHECK_STREQ(jvm.staticField("android/os/Build", "FINGERPRINT"),
+                "google/husky/husky:14/UQ1A.240205.004/11269751:user/release-keys");
+    CHECK_STREQ(jvm.staticField("android/os/Build", "MODEL"), "Pixel 8 Pro");
+
+    // Otherwise the greatest level below it; invalid levels are skipped
+    jvm.reset();
+    CHECK(zygisk.runApp({UID_GAME_TWO, nullptr, nullptr}));
+    CHECK_STREQ(jvm.staticField("android/os/Build", "MODEL"), "SM-X706B");
+    char model[PROP_VALUE_MAX] = {};
+    __system_property_get("ro.soc.model", model);
+    CHECK_STREQ(model, "SM8450");
+}
+
+TEST(extends_cycle_keeps_own_fields) {
+    HostEnv::writeConfig(R"({
+      "PACKAGES_A": ["com.game.one"],
+      "PACKAGES_A_DEVICE": {"extends": "LOOP", "MODEL": "own"},
+      "LOOP": {"extends": "PACKAGES_A_DEVICE", "BRAND": "loop"},
+      "PACKAGES_B": ["com.game.two"],
+      "PACKAGES_B_DEVICE": {"extends": "MISSING", "MODEL": "orphan"}
+    })");
+    HostEnv::writePackagesList(TEST_PACKAGES_LIST);
+    CHECK_STREQ(spoofedModel(UID_GAME_ONE), "own");
+    CHECK_STREQ(spoofedModel(UID_GAME_TWO), "orphan");
+}
+
+TEST(generated_config_matches_its_trace) {
+    GeneratorOptions options;
+    options.groups = 6;
+    options.packagesPerGroup = 4;
+    options.extendedRatio = 1.0;
+    ConfigGenerator generator(options);
+    CHECK(generator.writeModuleFiles());
+
+    for (const auto &launch : generator.trace(40, 0.5, 2)) {
+        CHECK_EQ(spoofedModel(launch.uid) != nullptr, launch.targeted);
+    }
+    // Empty pools are never drawn from
+    options.plainPackages = 0;
+    for (const auto &launch : ConfigGenerator(options).trace(20, 0.5)) CHECK(launch.targeted);
+    options.groups = 0;
+    options.plainPackages = 3;
+    for (const auto &launch : ConfigGenerator(options).trace(20, 0.5)) CHECK(!launch.targeted);
+    options.plainPackages = 0;
+    CHECK(ConfigGenerator(options).trace(20, 0.5).empty());
+}
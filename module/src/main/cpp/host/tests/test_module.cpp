@@ -0,0 +1,506 @@
+#include <dlfcn.h>
+#include <fcntl.h>
+#include <sys/system_properties.h>
+#include <unistd.h>
+#include <cstdio>
+#include <string>
+
+#include "alloc_counter.hpp"
+#include "builtin.hpp"
+#include "android_stubs.hpp"
+#include "fixtures.hpp"
+#include "host_env.hpp"
+#include "test.hpp"
+
+// App-side behaviour of the module, driven through the Zygisk ABI
+
+static const char *property(const char *name) {
+    static char value[PROP_VALUE_MAX];
+    __system_property_get(name, value);
+    return value;
+}
+
+static void installFixture() {
+    HostEnv::writeConfig(TEST_CONFIG);
+    HostEnv::writePackagesList(TEST_PACKAGES_LIST);
+}
+
+TEST(targeted_app_gets_build_fields_in_pre_and_properties_in_post) {
+    installFixture();
+    FakeJvm jvm;
+    FakeZygisk zygisk(jvm, HostEnv::companion());
+    CHECK(zygisk.load());
+
+    zygisk.preAppSpecialize({UID_GAME_ONE, "com.game.one", "/data/user/0/com.game.one"});
+    CHECK_STREQ(jvm.staticField("android/os/Build", "MODEL"), "Pixel 8 Pro");
+    CHECK_STREQ(jvm.staticField("android/os/Build", "FINGERPRINT"),
+                "google/husky/husky:14/AP1A.240505.004/11583682:user/release-keys");
+    CHECK_EQ(copg_host_properties_set_count(), 0);
+    CHECK(zygisk.denylistUnmount);
+    CHECK(zygisk.dlcloseRequested);
+    CHECK_EQ(jvm.liveLocalRefs(), 0);
+    CHECK_EQ(zygisk.companionConnections, 1);
+    CHECK_EQ(zygisk.exemptedFds, 1);
+
+    // Set from the app's context, after specialization
+    zygisk.postAppSpecialize();
+    CHECK_STREQ(property("ro.product.model"), "Pixel 8 Pro");
+    CHECK_STREQ(property("ro.product.vendor.brand"), "google");
+    CHECK_STREQ(property("ro.product.odm.model"), "Pixel 8 Pro");
+    CHECK_STREQ(property("ro.product.system_ext.manufacturer"), "Google");
+    CHECK_STREQ(property("ro.bootimage.build.fingerprint"),
+                "google/husky/husky:14/AP1A.240505.004/11583682:user/release-keys");
+    CHECK_STREQ(property("ro.build.fingerprint"),
+                "google/husky/husky:14/AP1A.240505.004/11583682:user/release-keys");
+}
+
+TEST(extended_fields_reach_build_and_properties) {
+    installFixture();
+    FakeJvm jvm;
+    FakeZygisk zygisk(jvm, HostEnv::companion());
+    CHECK(zygisk.runApp({UID_GAME_TWO, "com.game.two", "/data/user/0/com.game.two"}));
+
+    CHECK_STREQ(jvm.staticField("android/os/Build", "BOARD"), "kalama");
+    CHECK_STREQ(property("ro.hardware"), "qcom");
+    CHECK(jvm.staticField("android/os/Build", "SERIAL") == nullptr);
+}
+
+TEST(profile_props_are_applied_with_derived_properties) {
+    HostEnv::writeConfig(R"({
+      "SOC_BASE": {
+        "HARDWARE": "qcom",
+        "PROPS": {"ro.soc.manufacturer": "QTI", "ro.soc.model": "SM8550", "ro.board.platform": "kalama"}
+      },
+      "PACKAGES_TAB": ["com.game.two"],
+      "PACKAGES_TAB_DEVICE": {
+        "extends": "SOC_BASE",
+        "BRAND": "samsung",
+        "MODEL": "SM-X710",
+        "PROPS": {"ro.product.vendor.model": "SM-X710N", "ro.board.platform": ""}
+      }
+    })");
+    HostEnv::writePackagesList(TEST_PACKAGES_LIST);
+    FakeJvm jvm;
+    FakeZygisk zygisk(jvm, HostEnv::companion());
+    CHECK(zygisk.runApp({UID_GAME_TWO, "com.game.two", "/data/user/0/com.game.two"}));
+
+    CHECK_STREQ(property("ro.soc.manufacturer"), "QTI");
+    CHECK_STREQ(property("ro.soc.model"), "SM8550");
+    CHECK_STREQ(property("ro.hardware"), "qcom");
+    CHECK_STREQ(property("ro.product.brand"), "samsung");
+    CHECK_STREQ(property("ro.product.model"), "SM-X710");
+    // PROPS win over derived properties, and an empty value drops the base's
+    CHECK_STREQ(property("ro.product.vendor.model"), "SM-X710N");
+    CHECK_STREQ(property("ro.board.platform"), "");
+}
+
+TEST(auxiliary_process_is_not_spoofed_by_default) {
+    installFixture();
+    FakeJvm jvm;
+    FakeZygisk zygisk(jvm, HostEnv::companion());
+    CHECK(zygisk.runApp({UID_GAME_ONE, "com.game.one:push", "/data/user/0/com.game.one"}));
+
+    CHECK(jvm.staticField("android/os/Build", "MODEL") == nullptr);
+    CHECK_EQ(copg_host_properties_set_count(), 0);
+    CHECK(zygisk.dlcloseRequested);
+    CHECK(!zygisk.denylistUnmount);
+}
+
+TEST(process_rules_select_spoofed_processes) {
+    HostEnv::writeConfig(R"({
+      "PACKAGES_PIXEL": ["com.game.one"],
+      "PACKAGES_PIXEL_DEVICE": {"MODEL": "Pixel 8 Pro"},
+      "PACKAGES_PIXEL_PROCESSES": [":game", "com.game.shared"],
+      "PACKAGES_TAB": ["com.game.two"],
+      "PACKAGES_TAB_DEVICE": {"MODEL": "SM-X710"},
+      "PACKAGES_TAB_PROCESSES": ["*"]
+    })");
+    HostEnv::writePackagesList(TEST_PACKAGES_LIST);
+    FakeJvm jvm;
+    FakeZygisk zygisk(jvm, HostEnv::companion());
+
+    const char *spoofed[][2] = {
+        {"com.game.one", "Pixel 8 Pro"},
+        {"com.game.one:game", "Pixel 8 Pro"},
+        {"com.game.shared", "Pixel 8 Pro"},
+        {"com.game.one:push", nullptr},
+    };
+    for (const auto &[process, model] : spoofed) {
+        jvm.reset();
+        CHECK(zygisk.runApp({UID_GAME_ONE, process, "/data/user/0/com.game.one"}));
+        if (model) {
+            CHECK_STREQ(jvm.staticField("android/os/Build", "MODEL"), model);
+        } else {
+            CHECK(jvm.staticField("android/os/Build", "MODEL") == nullptr);
+        }
+    }
+
+    jvm.reset();
+    CHECK(zygisk.runApp({UID_GAME_TWO, "com.game.two:remote", "/data/user/0/com.game.two"}));
+    CHECK_STREQ(jvm.staticField("android/os/Build", "MODEL"), "SM-X710");
+}
+
+TEST(longest_package_name_is_spoofed) {
+    // A package name of the full length, main and auxiliary processes
+    std::string package = "com.game.";
+    package.append(PACKAGE_NAME_MAX - package.size(), 'l');
+    std::string config = R"({"PACKAGES_LONG": [")" + package + R"("],
+      "PACKAGES_LONG_DEVICE": {"MODEL": "long"}, "PACKAGES_LONG_PROCESSES": [":game"]})";
+    HostEnv::writeConfig(config.c_str());
+    std::string packages = std::string(TEST_PACKAGES_LIST) + package + " 10300 0 /data/user/0/" + package +
+                           " default:targetSdkVersion=34 none\n";
+    HostEnv::writePackagesList(packages.c_str());
+    FakeJvm jvm;
+    FakeZygisk zygisk(jvm, HostEnv::companion());
+
+    std::string dataDir = "/data/user/0/" + package;
+    CHECK(zygisk.runApp({10300, package.c_str(), dataDir.c_str()}));
+    CHECK_STREQ(jvm.staticField("android/os/Build", "MODEL"), "long");
+
+    // Beyond the request, so never matched
+    jvm.reset();
+    std::string process = package + ":game";
+    CHECK(zygisk.runApp({10300, process.c_str(), dataDir.c_str()}));
+    CHECK(jvm.staticField("android/os/Build", "MODEL") == nullptr);
+}
+
+// Reads everything a hooked open left at fd
+static std::string readAll(int fd) {
+    std::string content;
+    char buffer[4096];
+    ssize_t n;
+    while ((n = read(fd, buffer, sizeof(buffer))) > 0) content.append(buffer, n);
+    close(fd);
+    return content;
+}
+
+TEST(soc_files_are_served_from_memory) {
+    HostEnv::writeConfig(R"({
+      "PACKAGES_TAB": ["com.game.two"],
+      "PACKAGES_TAB_DEVICE": {
+        "MODEL": "SM-X710",
+        "SOC": {"cpuinfo": "Qualcomm Technologies, Inc SM8550", "machine": "SM8550", "soc_id": "519"}
+      }
+    })");
+    HostEnv::writePackagesList(TEST_PACKAGES_LIST);
+    FakeJvm jvm;
+    FakeZygisk zygisk(jvm, HostEnv::companion());
+    CHECK(zygisk.load());
+    zygisk.preAppSpecialize({UID_GAME_TWO, "com.game.two", "/data/user/0/com.game.two"});
+    zygisk.postAppSpecialize();
+    CHECK(!zygisk.dlcloseRequested);
+    CHECK(zygisk.pltHookLibraries > 0);
+
+    using OpenFn = int (*)(const char *, int, ...);
+    using OpenatFn = int (*)(int, const char *, int, ...);
+    using FopenFn = FILE *(*)(const char *, const char *);
+    auto openHook = zygisk.pltHook<OpenFn>("open");
+    auto openatHook = zygisk.pltHook<OpenatFn>("openat");
+    auto fopenHook = zygisk.pltHook<FopenFn>("fopen");
+    CHECK(openHook && openatHook && fopenHook && zygisk.pltHook<void *>("__open_2"));
+
+    // The real cpuinfo, with the Hardware line of the profile at its end
+    std::string cpuinfo = readAll(openHook("/proc/cpuinfo", O_RDONLY | O_CLOEXEC));
+    CHECK(cpuinfo.find("processor") != std::string::npos);
+    const std::string hardware = "\nHardware\t: Qualcomm Technologies, Inc SM8550\n";
+    CHECK(cpuinfo.size() > hardware.size() &&
+          cpuinfo.compare(cpuinfo.size() - hardware.size(), hardware.size(), hardware) == 0);
+    CHECK_EQ(cpuinfo.find("Hardware"), cpuinfo.rfind("Hardware"));
+
+    CHECK_STREQ(readAll(openatHook(AT_FDCWD, "/sys/devices/soc0/soc_id", O_RDONLY)).c_str(), "519\n");
+    CHECK_STREQ(readAll(openHook("/sys/bus/soc/devices/soc0/machine", O_RDONLY)).c_str(), "SM8550\n");
+    FILE *file = fopenHook("/sys/devices/soc0/machine", "re");
+    char line[64] = {};
+    CHECK(file && fgets(line, sizeof(line), file));
+    CHECK_STREQ(line, "SM8550\n");
+    if (file) fclose(file);
+
+    // Anything else reaches the real function
+    CHECK_EQ(openHook("/sys/devices/soc0/family", O_RDONLY), -1);
+    std::string config = readAll(openHook(MODULE_DIR "/config.json", O_RDONLY));
+    CHECK(config.find("SM8550") != std::string::npos);
+    zygisk.unload();
+
+    // Profiles without SOC keep unloading right after pre
+    installFixture();
+    CHECK(zygisk.runApp({UID_GAME_TWO, "com.game.two", "/data/user/0/com.game.two"}));
+    CHECK(zygisk.dlcloseRequested);
+    CHECK_EQ(zygisk.pltHookLibraries, 0);
+}
+
+TEST(gl_strings_come_from_the_profile) {
+    // Mapped and global before the module loads, as on device
+    void *gles = dlopen(COPG_HOST_GLES_PATH, RTLD_NOW | RTLD_GLOBAL);
+    CHECK(gles);
+    HostEnv::writeConfig(R"({
+      "PACKAGES_TAB": ["com.game.two"],
+      "PACKAGES_TAB_DEVICE": {"MODEL": "SM-X710", "GL_RENDERER": "Adreno (TM) 740", "GL_VENDOR": "Qualcomm"}
+    })");
+    HostEnv::writePackagesList(TEST_PACKAGES_LIST);
+    FakeJvm jvm;
+    FakeZygisk zygisk(jvm, HostEnv::companion());
+    CHECK(zygisk.load());
+    zygisk.preAppSpecialize({UID_GAME_TWO, "com.game.two", "/data/user/0/com.game.two"});
+    zygisk.postAppSpecialize();
+    CHECK(!zygisk.dlcloseRequested);
+    CHECK_STREQ(jvm.staticField("android/os/Build", "MODEL"), "SM-X710");
+    CHECK(zygisk.pltHook<void *>("open") == nullptr);
+
+    using GetStringFn = const unsigned char *(*)(unsigned);
+    auto getString = zygisk.pltHook<GetStringFn>("glGetString");
+    CHECK(getString);
+    auto text = [&](unsigned name) { return reinterpret_cast<const char *>(getString(name)); };
+    CHECK_STREQ(text(0x1F01), "Adreno (TM) 740");
+    CHECK_STREQ(text(0x1F00), "Qualcomm");
+    CHECK_STREQ(text(0x1F02), "OpenGL ES 3.2 Stub");
+
+    // Answered from the same buffer every time
+    AllocScope scope;
+    CHECK(getString(0x1F01) == getString(0x1F01));
+    CHECK_EQ(scope.allocations(), 0);
+    zygisk.unload();
+    dlclose(gles);
+}
+
+TEST(libraries_loaded_later_get_the_gl_hooks) {
+    void *gles = dlopen(COPG_HOST_GLES_PATH, RTLD_NOW | RTLD_GLOBAL);
+    CHECK(gles);
+    HostEnv::writeConfig(R"({
+      "PACKAGES_TAB": ["com.game.two"],
+      "PACKAGES_TAB_DEVICE": {"MODEL": "SM-X710", "GL_RENDERER": "Adreno (TM) 740"}
+    })");
+    HostEnv::writePackagesList(TEST_PACKAGES_LIST);
+    FakeJvm jvm;
+    FakeZygisk zygisk(jvm, HostEnv::companion());
+    CHECK(zygisk.patchPlt(COPG_HOST_GAME_PATH));
+    CHECK(!isMapped(COPG_HOST_GAME_PATH));
+    CHECK(zygisk.load());
+    zygisk.preAppSpecialize({UID_GAME_TWO, "com.game.two", "/data/user/0/com.game.two"});
+    zygisk.postAppSpecialize();
+    int libraries = zygisk.pltHookLibraries;
+
+    // The engine comes in through the app's own dlopen, long after post
+    using DlopenFn = void *(*)(const char *, int);
+    auto hookedDlopen = zygisk.pltHook<DlopenFn>("dlopen");
+    CHECK(hookedDlopen);
+    void *game = hookedDlopen(COPG_HOST_GAME_PATH, RTLD_NOW);
+    CHECK(game);
+    CHECK_EQ(zygisk.pltHookLibraries, libraries + 1);
+    auto renderer = reinterpret_cast<const char *(*)()>(dlsym(game, "gameRenderer"));
+    CHECK(renderer);
+    CHECK_STREQ(renderer(), "Adreno (TM) 740");
+
+    // Loading it again maps nothing new, so nothing is registered twice
+    void *again = hookedDlopen(COPG_HOST_GAME_PATH, RTLD_NOW);
+    CHECK(again == game);
+    CHECK_EQ(zygisk.pltHookLibraries, libraries + 1);
+    dlclose(again);
+
+    zygisk.unload();
+    CHECK_STREQ(renderer(), "Stub Renderer");
+    dlclose(game);
+    dlclose(gles);
+}
+
+static void installSocProfile() {
+    HostEnv::writeConfig(R"({
+      "PACKAGES_TAB": ["com.game.two"],
+      "PACKAGES_TAB_DEVICE": {"MODEL": "SM-X710", "SOC": {"machine": "SM8550", "soc_id": "519"}}
+    })");
+    HostEnv::writePackagesList(TEST_PACKAGES_LIST);
+}
+
+// What the game library reads for the SoC machine through its own open
+static std::string gameMachine(void *game) {
+    auto gameOpen = reinterpret_cast<int (*)(const char *)>(dlsym(game, "gameOpen"));
+    return gameOpen ? readAll(gameOpen("/sys/devices/soc0/machine")) : std::string();
+}
+
+TEST(libraries_loaded_later_get_the_soc_files) {
+    installSocProfile();
+    FakeJvm jvm;
+    FakeZygisk zygisk(jvm, HostEnv::companion());
+    CHECK(zygisk.patchPlt(COPG_HOST_GAME_PATH));
+    CHECK(zygisk.load());
+    zygisk.preAppSpecialize({UID_GAME_TWO, "com.game.two", "/data/user/0/com.game.two"});
+    zygisk.postAppSpecialize();
+    int libraries = zygisk.pltHookLibraries;
+
+    using DlopenFn = void *(*)(const char *, int);
+    auto hookedDlopen = zygisk.pltHook<DlopenFn>("dlopen");
+    CHECK(hookedDlopen);
+    void *game = hookedDlopen(COPG_HOST_GAME_PATH, RTLD_NOW);
+    CHECK(game);
+    CHECK(zygisk.pltHookLibraries > libraries);
+    auto gameOpen = reinterpret_cast<int (*)(const char *)>(dlsym(game, "gameOpen"));
+    auto gameFopen = reinterpret_cast<FILE *(*)(const char *)>(dlsym(game, "gameFopen"));
+    CHECK(gameOpen && gameFopen);
+
+    // Served through the engine's own open and fopen calls
+    CHECK_STREQ(readAll(gameOpen("/sys/devices/soc0/machine")).c_str(), "SM8550\n");
+    FILE *file = gameFopen("/sys/bus/soc/devices/soc0/soc_id");
+    char line[64] = {};
+    CHECK(file && fgets(line, sizeof(line), file));
+    CHECK_STREQ(line, "519\n");
+    if (file) fclose(file);
+
+    zygisk.unload();
+    dlclose(game);
+}
+
+TEST(libraries_loaded_under_any_name_get_the_soc_files) {
+    installSocProfile();
+    FakeJvm jvm;
+    FakeZygisk zygisk(jvm, HostEnv::companion());
+    CHECK(zygisk.patchPlt(COPG_HOST_GAME_COPY_PATH));
+    CHECK(zygisk.load());
+    zygisk.preAppSpecialize({UID_GAME_TWO, "com.game.two", "/data/user/0/com.game.two"});
+    zygisk.postAppSpecialize();
+
+    using DlopenFn = void *(*)(const char *, int);
+    auto hookedDlopen = zygisk.pltHook<DlopenFn>("dlopen");
+    CHECK(hookedDlopen);
+    void *game = hookedDlopen(COPG_HOST_GAME_COPY_PATH, RTLD_NOW);
+    CHECK(game);
+    CHECK_STREQ(gameMachine(game).c_str(), "SM8550\n");
+
+    zygisk.unload();
+    dlclose(game);
+}
+
+TEST(libraries_loaded_again_get_the_soc_files_again) {
+    installSocProfile();
+    FakeJvm jvm;
+    FakeZygisk zygisk(jvm, HostEnv::companion());
+    CHECK(zygisk.patchPlt(COPG_HOST_GAME_PATH));
+    CHECK(zygisk.load());
+    zygisk.preAppSpecialize({UID_GAME_TWO, "com.game.two", "/data/user/0/com.game.two"});
+    zygisk.postAppSpecialize();
+
+    using DlopenFn = void *(*)(const char *, int);
+    using DlcloseFn = int (*)(void *);
+    auto hookedDlopen = zygisk.pltHook<DlopenFn>("dlopen");
+    auto hookedDlclose = zygisk.pltHook<DlcloseFn>("dlclose");
+    CHECK(hookedDlopen && hookedDlclose);
+    void *game = hookedDlopen(COPG_HOST_GAME_PATH, RTLD_NOW);
+    CHECK(game);
+    CHECK_STREQ(gameMachine(game).c_str(), "SM8550\n");
+
+    // Closed and loaded again, quite possibly at the same base
+    CHECK_EQ(hookedDlclose(game), 0);
+    CHECK(!isMapped(COPG_HOST_GAME_PATH));
+    game = hookedDlopen(COPG_HOST_GAME_PATH, RTLD_NOW);
+    CHECK(game);
+    CHECK_STREQ(gameMachine(game).c_str(), "SM8550\n");
+
+    zygisk.unload();
+    dlclose(game);
+}
+
+// host/tests/builtin_config.json is built into the host module
+TEST(builtin_profiles_answer_without_companion) {
+    __system_property_set(BUILTIN_CONFIG_PROPERTY, BUILTIN_CONFIG_VALUE);
+    __system_property_set("ro.build.version.sdk", HOST_SDK_LEVEL);
+    FakeJvm jvm;
+    FakeZygisk zygisk(jvm, HostEnv::companion());
+
+    CHECK(zygisk.runApp({UID_GAME_ONE, "com.game.one", "/data/user/0/com.game.one"}));
+    CHECK_STREQ(jvm.staticField("android/os/Build", "MODEL"), "Pixel 8 Pro");
+    CHECK_STREQ(jvm.staticField("android/os/Build", "BRAND"), "google");
+    CHECK_STREQ(property("ro.product.odm.manufacturer"), "Google");
+    CHECK(zygisk.denylistUnmount);
+    CHECK(zygisk.dlcloseRequested);
+
+    jvm.reset();
+    CHECK(zygisk.runApp({UID_GAME_TWO, "com.game.two", "/data/user/0/com.game.two"}));
+    CHECK_STREQ(jvm.staticField("android/os/Build", "MODEL"), "SM-X710N");  // BY_SDK 33
+    CHECK_STREQ(property("ro.hardware"), "qcom");
+
+    jvm.reset();
+    CHECK(zygisk.runApp({UID_GAME_ONE, "com.game.one:push", "/data/user/0/com.game.one"}));
+    CHECK(jvm.staticField("android/os/Build", "MODEL") == nullptr);
+    CHECK(zygisk.runApp({UID_OTHER_APP, "com.other.app", "/data/user/0/com.other.app"}));
+    CHECK(jvm.staticField("android/os/Build", "MODEL") == nullptr);
+    CHECK(zygisk.dlcloseRequested);
+    CHECK_EQ(zygisk.companionConnections, 0);
+}
+
+TEST(builtin_package_index_finds_every_name) {
+    static constexpr std::array<BuiltinPackage, 5> packages = {{
+        {"com.game.one", 0}, {"com.game.two", 1}, {"com.game.three", 0}, {"org.example", 2}, {"a", 1},
+    }};
+    static constexpr PackageIndex<packages.size()> index{packages};
+    for (const auto &package : packages) CHECK(index.find(package.name, packages) == &package);
+    CHECK(index.find("com.game.four", packages) == nullptr);
+    CHECK(index.find("", packages) == nullptr);
+
+    static constexpr std::array<BuiltinPackage, 0> none{};
+    static constexpr PackageIndex<0> empty{none};
+    CHECK(empty.find("com.game.one", none) == nullptr);
+}
+
+TEST(targeted_app_leaves_no_mapping_or_heap) {
+    installFixture();
+    FakeJvm jvm;
+    FakeZygisk zygisk(jvm, HostEnv::companion());
+    const AppProcess app{UID_GAME_ONE, "com.game.one", "/data/user/0/com.game.one"};
+
+    // The first cycle pays for one-time dynamic linker and libc caches
+    CHECK(zygisk.runApp(app));
+
+    int64_t before = liveHeapBytes();
+    CHECK(zygisk.load());
+    zygisk.preAppSpecialize(app);
+    zygisk.postAppSpecialize();
+    CHECK(zygisk.dlcloseRequested);
+    zygisk.unload();
+
+    CHECK_EQ(liveHeapBytes() - before, 0);
+    CHECK(!isMapped(COPG_HOST_MODULE_PATH));
+}
+
+TEST(untargeted_app_does_not_allocate) {
+    installFixture();
+    FakeJvm jvm;
+    FakeZygisk zygisk(jvm, HostEnv::companion());
+    CHECK(zygisk.load());
+
+    AllocScope scope;
+    zygisk.preAppSpecialize({UID_OTHER_APP, "com.other.app", "/data/user/0/com.other.app"});
+    zygisk.postAppSpecialize();
+    CHECK_EQ(scope.allocations(), 0);
+
+    CHECK_EQ(zygisk.companionConnections, 1);
+    CHECK(zygisk.dlcloseRequested);
+    CHECK(!zygisk.denylistUnmount);
+    CHECK_EQ(copg_host_properties_set_count(), 0);
+}
+
+TEST(non_application_uid_skips_companion) {
+    installFixture();
+    FakeJvm jvm;
+    FakeZygisk zygisk(jvm, HostEnv::companion());
+
+    // Isolated service process of a targeted app
+    CHECK(zygisk.runApp({99000, "com.game.one:sandboxed_process0", "/data/user/0/com.game.one"}));
+    CHECK_EQ(zygisk.companionConnections, 0);
+    CHECK(zygisk.dlcloseRequested);
+}
+
+TEST(system_server_unloads_module) {
+    FakeJvm jvm;
+    FakeZygisk zygisk(jvm, HostEnv::companion());
+    CHECK(zygisk.load());
+    zygisk.preServerSpecialize();
+    CHECK(zygisk.dlcloseRequested);
+    CHECK_EQ(zygisk.companionConnections, 0);
+}
+
+TEST(companion_unavailable_leaves_app_untouched) {
+    installFixture();
+    FakeJvm jvm;
+    FakeZygisk zygisk(jvm, nullptr);
+    CHECK(zygisk.runApp({UID_GAME_ONE, "com.game.one", "/data/user/0/com.game.one"}));
+    CHECK(zygisk.dlcloseRequested);
+    CHECK(jvm.staticField("android/os/Build", "MODEL") == nullptr);
+}
@@ -0,0 +1,157 @@
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <string>
+
+#include "alloc_counter.hpp"
+#include "fixtures.hpp"
+#include "host_env.hpp"
+#include "protocol.hpp"
+#include "test.hpp"
+
+// JNI calls and allocations per launch phase, held against the bounds in
+// profile_thresholds.txt
+
+// scope -> metric -> value, scope being a phase name or "launch"
+using Profile = std::map<std::string, std::map<std::string, long long>>;
+
+namespace {
+
+struct Counters {
+    AllocStats alloc;
+    JniCallCounts jni;
+
+    // Accumulates end - start; no allocation, the probe runs mid-launch
+    void add(const Counters &start, const Counters &end) {
+        alloc.allocations += end.alloc.allocations - start.alloc.allocations;
+        alloc.bytes += end.alloc.bytes - start.alloc.bytes;
+        for (int i = 0; i < static_cast<int>(JniFunction::COUNT); i++) {
+            jni.calls[i] += end.jni.calls[i] - start.jni.calls[i];
+        }
+    }
+};
+
+class PhaseProfiler {
+public:
+    explicit PhaseProfiler(const FakeJvm &jvm) : jvm(jvm) {}
+
+    void begin(LaunchPhase phase) { open[phase] = sample(); }
+    void end(LaunchPhase phase) {
+        totals[phase].add(open[phase], sample());
+        seen[phase] = true;
+    }
+
+    Profile run(FakeZygisk &zygisk, const AppProcess &process) {
+        Counters start = sample();
+        zygisk.preAppSpecialize(process);
+        zygisk.postAppSpecialize();
+        launch.add(start, sample());
+
+        Profile profile;
+        convert(launch, profile["launch"]);
+        for (uint32_t phase = 0; phase < PHASE_COUNT; phase++) {
+            if (seen[phase]) convert(totals[phase], profile[PHASE_NAMES[phase]]);
+        }
+        return profile;
+    }
+
+private:
+    const FakeJvm &jvm;
+    Counters open[PHASE_COUNT]{};
+    Counters totals[PHASE_COUNT]{};
+    bool seen[PHASE_COUNT]{};
+    Counters launch{};
+
+    Counters sample() const { return {threadAllocStats(), jvm.callCounts()}; }
+
+    static void convert(const Counters &counters, std::map<std::string, long long> &metrics) {
+        metrics["allocations"] = static_cast<long long>(counters.alloc.allocations);
+        metrics["alloc_bytes"] = static_cast<long long>(counters.alloc.bytes);
+        metrics["jni"] = counters.jni.total();
+        for (int i = 0; i < static_cast<int>(JniFunction::COUNT); i++) {
+            auto function = static_cast<JniFunction>(i);
+            metrics[std::string("jni.") + JniCallCounts::name(function)] = counters.jni[function];
+        }
+    }
+};
+
+PhaseProfiler *activeProfiler;
+
+} // namespace
+
+extern "C" [[gnu::visibility("default")]] void copg_phase_probe(LaunchPhase phase, bool begin) {
+    if (!activeProfiler) return;
+    if (begin) {
+        activeProfiler->begin(phase);
+    } else {
+        activeProfiler->end(phase);
+    }
+}
+
+static Profile profileLaunch(const AppProcess &process) {
+    FakeJvm jvm;
+    FakeZygisk zygisk(jvm, HostEnv::companion());
+
+    // The first cycle pays for one-time dynamic linker and libc caches
+    zygisk.runApp(process);
+    jvm.reset();
+
+    zygisk.load();
+    PhaseProfiler profiler(jvm);
+    activeProfiler = &profiler;
+    Profile profile = profiler.run(zygisk, process);
+    activeProfiler = nullptr;
+    return profile;
+}
+
+static void printProfile(const char *launch, const Profile &profile) {
+    for (const auto &[scope, metrics] : profile) {
+        for (const auto &[metric, value] : metrics) {
+            if (value) fprintf(stderr, "  %s %s %s %lld\n", launch, scope.c_str(), metric.c_str(), value);
+        }
+    }
+}
+
+TEST(launch_profile_stays_within_thresholds) {
+    HostEnv::writeConfig(TEST_CONFIG);
+    HostEnv::writePackagesList(TEST_PACKAGES_LIST);
+    std::map<std::string, Profile> launches;
+    launches["targeted"] = profileLaunch({UID_GAME_TWO, "com.game.two", "/data/user/0/com.game.two"});
+    launches["untargeted"] = profileLaunch({UID_OTHER_APP, "com.other.app", "/data/user/0/com.other.app"});
+
+    FILE *file = fopen(COPG_PROFILE_THRESHOLDS_PATH, "r");
+    CHECK(file != nullptr);
+
+    // Every line is checked, so one run reports every regression
+    int checked = 0;
+    int failed = 0;
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        char launch[32], scope[32], metric[64];
+        long long limit;
+        if (line[0] == '#' || sscanf(line, "%31s %31s %63s %lld", launch, scope, metric, &limit) != 4) continue;
+        checked++;
+
+        auto profile = launches.find(launch);
+        bool known = profile != launches.end() && profile->second.count(scope) &&
+                     profile->second.at(scope).count(metric);
+        if (!known) {
+            fprintf(stderr, "  no measurement for threshold: %s", line);
+            failed++;
+            continue;
+        }
+        long long value = profile->second.at(scope).at(metric);
+        if (value > limit) {
+            fprintf(stderr, "  %s %s %s: %lld, threshold %lld\n", launch, scope, metric, value, limit);
+            failed++;
+        }
+    }
+    fclose(file);
+
+    if (failed) {
+        fprintf(stderr, "  measured:\n");
+        for (const auto &[launch, profile] : launches) printProfile(launch.c_str(), profile);
+    }
+    CHECK(checked > 0);
+    CHECK_EQ(failed, 0);
+}
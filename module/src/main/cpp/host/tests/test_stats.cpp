@@ -0,0 +1,67 @@
+#include <unistd.h>
+#include <cstdio>
+#include <vector>
+
+#include "fixtures.hpp"
+#include "host_env.hpp"
+#include "stats.hpp"
+#include "test.hpp"
+
+// Companion-side launch statistics and the stats file format
+
+static bool readStats(StatsSnapshot &stats) {
+    FILE *file = fopen(STATS_PATH, "rb");
+    if (!file) return false;
+    std::vector<uint8_t> data(1 << 20);
+    data.resize(fread(data.data(), 1, data.size(), file));
+    fclose(file);
+    return stats.parse(data.data(), data.size());
+}
+
+static void launch(int uid) {
+    FakeJvm jvm;
+    FakeZygisk zygisk(jvm, HostEnv::companion());
+    zygisk.runApp({uid, nullptr, nullptr});
+}
+
+TEST(log_linear_buckets_bound_every_value) {
+    for (uint64_t value = 0; value <= UINT32_MAX; value = value * 5 / 4 + 1) {
+        uint32_t index = LogLinearBuckets::indexOf(static_cast<uint32_t>(value));
+        CHECK(index < LogLinearBuckets::COUNT);
+        CHECK(LogLinearBuckets::lowerBound(index) <= value);
+        CHECK(LogLinearBuckets::upperBound(index) > value);
+        // At most 1/16 of relative error
+        CHECK((LogLinearBuckets::upperBound(index) - LogLinearBuckets::lowerBound(index)) * 16 <=
+              (LogLinearBuckets::lowerBound(index) > 16 ? LogLinearBuckets::lowerBound(index) : 16));
+    }
+}
+
+TEST(launches_are_persisted_to_stats_file) {
+    HostEnv::writeConfig(TEST_CONFIG);
+    HostEnv::writePackagesList(TEST_PACKAGES_LIST);
+    launch(UID_GAME_ONE);
+    launch(UID_OTHER_APP);
+
+    // Persisted at most every 50ms on the host, by whichever launch comes next.
+    // A copy can catch a package slot claimed but not yet counted, so wait
+    // for the counts themselves.
+    StatsSnapshot stats;
+    const StatsPackage *hit = nullptr;
+    const StatsPackage *miss = nullptr;
+    for (int attempt = 0; attempt < 50 && !(hit && hit->hits >= 2 && miss && miss->misses >= 1); attempt++) {
+        usleep(60 * 1000);
+        launch(UID_GAME_ONE);
+        if (!readStats(stats)) continue;
+        hit = stats.findPackage(AppKey::fromUid(UID_GAME_ONE));
+        miss = stats.findPackage(AppKey::fromUid(UID_OTHER_APP));
+    }
+
+    CHECK(hit && hit->hits >= 2);
+    CHECK(miss && miss->misses >= 1);
+
+    const auto *specialize = stats.find(PHASE_SPECIALIZE, OUTCOME_TARGETED);
+    CHECK(specialize && specialize->info.count >= 2);
+    CHECK(specialize && specialize->percentile(50) > 0);
+    const auto *properties = stats.find(PHASE_PROPERTIES, OUTCOME_UNTARGETED);
+    CHECK(properties && properties->info.count == 0);
+}
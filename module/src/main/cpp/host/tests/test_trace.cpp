@@ -0,0 +1,102 @@
+#include <unistd.h>
+#include <cstdio>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "fixtures.hpp"
+#include "host_env.hpp"
+#include "test.hpp"
+#include "trace.hpp"
+
+// atrace markers, with trace_marker pointed at a regular file
+
+struct TraceMarkers {
+    std::map<int, std::vector<std::string>> slices;  // pid -> begun slice names
+    std::map<int, int> depth;                         // pid -> open slices
+    bool wellFormed = true;
+
+    bool has(int pid, const char *name) const {
+        auto it = slices.find(pid);
+        if (it == slices.end()) return false;
+        for (const auto &slice : it->second) {
+            if (slice == name) return true;
+        }
+        return false;
+    }
+
+    bool balanced() const {
+        for (const auto &[pid, open] : depth) {
+            if (open) return false;
+        }
+        return wellFormed;
+    }
+};
+
+static TraceMarkers readMarkers() {
+    TraceMarkers markers;
+    FILE *file = fopen(TRACE_MARKER_PATH, "r");
+    if (!file) return markers;
+    char line[256];
+    while (fgets(line, sizeof(line), file)) {
+        char name[128];
+        int pid;
+        if (sscanf(line, "B|%d|%127[^\n]", &pid, name) == 2) {
+            markers.slices[pid].emplace_back(name);
+            markers.depth[pid]++;
+        } else if (sscanf(line, "E|%d", &pid) == 1) {
+            if (--markers.depth[pid] < 0) markers.wellFormed = false;
+        } else {
+            markers.wellFormed = false;
+        }
+    }
+    fclose(file);
+    return markers;
+}
+
+static void launch(int uid) {
+    FakeJvm jvm;
+    FakeZygisk zygisk(jvm, HostEnv::companion());
+    zygisk.runApp({uid, nullptr, nullptr});
+}
+
+TEST(trace_markers_cover_app_and_companion_phases) {
+    HostEnv::writeConfig(TEST_CONFIG);
+    HostEnv::writePackagesList(TEST_PACKAGES_LIST);
+    ModuleFiles::write("trace_marker", "");
+    ModuleFiles::write("trace", "");
+    launch(UID_GAME_ONE);
+
+    // The companion closes its last slice after the app is already gone
+    TraceMarkers markers;
+    int companionPid = -1;
+    for (int attempt = 0; attempt < 50; attempt++) {
+        markers = readMarkers();
+        for (const auto &[pid, names] : markers.slices) {
+            if (pid != getpid()) companionPid = pid;
+        }
+        if (companionPid > 0 && markers.balanced() && markers.has(companionPid, "copg.drain_log")) break;
+        usleep(20 * 1000);
+    }
+
+    CHECK(markers.balanced());
+    CHECK(markers.has(getpid(), "copg.build_fields"));
+    CHECK(markers.has(getpid(), "copg.properties"));
+    CHECK(markers.has(getpid(), "copg.report"));
+    CHECK(!markers.has(getpid(), "copg.connect"));
+    CHECK(markers.has(companionPid, "copg.companion"));
+    CHECK(markers.has(companionPid, "copg.snapshot"));
+    CHECK(markers.has(companionPid, "copg.lookup"));
+    CHECK(markers.has(companionPid, "copg.await_report"));
+}
+
+TEST(trace_markers_are_off_without_flag_file) {
+    HostEnv::writeConfig(TEST_CONFIG);
+    HostEnv::writePackagesList(TEST_PACKAGES_LIST);
+    ModuleFiles::write("trace_marker", "");
+    launch(UID_GAME_ONE);
+    launch(UID_OTHER_APP);
+
+    TraceMarkers markers = readMarkers();
+    CHECK(markers.slices.empty());
+}
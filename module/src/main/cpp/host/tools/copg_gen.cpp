@@ -0,0 +1,89 @@
+// Writes a generated config.json, packages.list and launch trace
+//
+// Usage: copg_gen --out DIR [--groups N] [--per-group N] [--plain N]
+//                 [--extended 0..1] [--no-comments] [--seed N]
+//                 [--launches N] [--hit-ratio 0..1] [--users N]
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+
+#include "generator.hpp"
+
+static bool writeFile(const std::string &path, const std::string &content) {
+    FILE *file = fopen(path.c_str(), "wb");
+    if (!file) {
+        perror(path.c_str());
+        return false;
+    }
+    bool written = fwrite(content.data(), 1, content.size(), file) == content.size();
+    return fclose(file) == 0 && written;
+}
+
+static int usage(const char *program) {
+    fprintf(stderr,
+            "usage: %s --out DIR [--groups N] [--per-group N] [--plain N] [--extended 0..1]\n"
+            "       [--no-comments] [--seed N] [--launches N] [--hit-ratio 0..1] [--users N]\n",
+            program);
+    return 2;
+}
+
+int main(int argc, char **argv) {
+    GeneratorOptions options;
+    const char *out = nullptr;
+    int launches = 10000;
+    double hitRatio = 0.5;
+    int users = 1;
+
+    for (int i = 1; i < argc; i++) {
+        if (!strcmp(argv[i], "--no-comments")) {
+            options.comments = false;
+            continue;
+        }
+        const char *value = i + 1 < argc ? argv[++i] : nullptr;
+        if (!value) return usage(argv[0]);
+        if (!strcmp(argv[i - 1], "--out")) {
+            out = value;
+        } else if (!strcmp(argv[i - 1], "--groups")) {
+            options.groups = atoi(value);
+        } else if (!strcmp(argv[i - 1], "--per-group")) {
+            options.packagesPerGroup = atoi(value);
+        } else if (!strcmp(argv[i - 1], "--plain")) {
+            options.plainPackages = atoi(value);
+        } else if (!strcmp(argv[i - 1], "--extended")) {
+            options.extendedRatio = atof(value);
+        } else if (!strcmp(argv[i - 1], "--seed")) {
+            options.seed = strtoull(value, nullptr, 0);
+        } else if (!strcmp(argv[i - 1], "--launches")) {
+            launches = atoi(value);
+        } else if (!strcmp(argv[i - 1], "--hit-ratio")) {
+            hitRatio = atof(value);
+        } else if (!strcmp(argv[i - 1], "--users")) {
+            users = atoi(value);
+        } else {
+            return usage(argv[0]);
+        }
+    }
+    if (!out || options.groups <= 0 || options.packagesPerGroup <= 0 || launches < 0 ||
+        users <= 0 || hitRatio < 0 || hitRatio > 1) {
+        return usage(argv[0]);
+    }
+
+    // Misses need plain packages to launch
+    ConfigGenerator generator(options);
+    if (launches > 0 && hitRatio < 1 && generator.plainPackages() == 0) {
+        fprintf(stderr, "--hit-ratio below 1 needs --plain above 0\n");
+        return usage(argv[0]);
+    }
+    std::string dir(out);
+    bool ok = writeFile(dir + "/config.json", generator.config()) &&
+              writeFile(dir + "/packages.list", generator.packagesList()) &&
+              writeFile(dir + "/trace.txt",
+                        ConfigGenerator::formatTrace(generator.trace(launches, hitRatio, users, options.seed)));
+    if (!ok) return 1;
+
+    printf("%d targeted and %d plain packages, %d launches written to %s\n",
+           generator.targetedPackages(), generator.plainPackages(), launches, out);
+    return 0;
+}
@@ -0,0 +1,110 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <initializer_list>
+#include <string_view>
+
+#include "protocol.hpp"
+
+// -----------------------------------------------------------
+// Profile fields and the properties derived from them
+//
+// Shared by the companion, which compiles them into every profile, and by
+// the app side, which expands the built-in profiles itself.
+// -----------------------------------------------------------
+
+// Fields of a profile, in DeviceConfig::forEachField order
+enum ProfileField : uint32_t {
+    FIELD_BRAND,
+    FIELD_DEVICE,
+    FIELD_MANUFACTURER,
+    FIELD_MODEL,
+    FIELD_FINGERPRINT,
+    FIELD_PRODUCT,
+    FIELD_BOARD,
+    FIELD_HARDWARE,
+    FIELD_SERIAL,
+    FIELD_GL_RENDERER,
+    FIELD_GL_VENDOR,
+    PROFILE_FIELD_COUNT,
+};
+
+static constexpr const char *PROFILE_KEYS[PROFILE_FIELD_COUNT] = {
+    "BRAND", "DEVICE", "MANUFACTURER", "MODEL", "FINGERPRINT",
+    "PRODUCT", "BOARD", "HARDWARE", "SERIAL", "GL_RENDERER", "GL_VENDOR",
+};
+
+// Partitions with their own ro.product.<partition>.* and
+// ro.<partition>.build.fingerprint; "" is the unqualified set
+static constexpr std::string_view PRODUCT_PARTITIONS[] = {
+    "", "bootimage", "odm", "product", "system", "system_ext", "vendor",
+};
+
+struct PropertySource {
+    std::string_view name;
+    ProfileField field;
+};
+
+static constexpr PropertySource PRODUCT_SUFFIXES[] = {
+    {"brand", FIELD_BRAND},
+    {"device", FIELD_DEVICE},
+    {"manufacturer", FIELD_MANUFACTURER},
+    {"model", FIELD_MODEL},
+    {"name", FIELD_PRODUCT},
+};
+
+// Properties without per-partition variants
+static constexpr PropertySource SINGLE_PROPERTIES[] = {
+    {"ro.build.product", FIELD_PRODUCT},
+    {"ro.product.board", FIELD_BOARD},
+    {"ro.hardware", FIELD_HARDWARE},
+    {"ro.serialno", FIELD_SERIAL},
+};
+
+// Longest derived name plus its NUL; a longer one fails to compile
+static constexpr size_t DERIVED_NAME_MAX = 48;
+
+struct DerivedProperty {
+    char name[DERIVED_NAME_MAX];
+    ProfileField field;
+};
+
+// parts joined with '.', empty ones skipped
+static constexpr DerivedProperty deriveProperty(std::initializer_list<std::string_view> parts, ProfileField field) {
+    DerivedProperty property{};
+    size_t length = 0;
+    for (std::string_view part : parts) {
+        if (part.empty()) continue;
+        if (length) property.name[length++] = '.';
+        for (char c : part) property.name[length++] = c;
+    }
+    property.name[length] = '\0';
+    property.field = field;
+    return property;
+}
+
+static constexpr size_t PARTITION_COUNT = sizeof(PRODUCT_PARTITIONS) / sizeof(PRODUCT_PARTITIONS[0]);
+static constexpr size_t DERIVED_PROPERTY_COUNT =
+    PARTITION_COUNT * (sizeof(PRODUCT_SUFFIXES) / sizeof(PRODUCT_SUFFIXES[0]) + 1) +
+    sizeof(SINGLE_PROPERTIES) / sizeof(SINGLE_PROPERTIES[0]);
+
+// Properties every profile sets from its fields, spelled out at compile
+// time so every partition gets the same set; PROPS entries win over them
+static constexpr auto DERIVED_PROPERTIES = [] {
+    std::array<DerivedProperty, DERIVED_PROPERTY_COUNT> table{};
+    size_t count = 0;
+    for (std::string_view partition : PRODUCT_PARTITIONS) {
+        for (const auto &suffix : PRODUCT_SUFFIXES) {
+            table[count++] = deriveProperty({"ro.product", partition, suffix.name}, suffix.field);
+        }
+        table[count++] = deriveProperty({"ro", partition, "build.fingerprint"}, FIELD_FINGERPRINT);
+    }
+    for (const auto &single : SINGLE_PROPERTIES) {
+        table[count++] = deriveProperty({single.name}, single.field);
+    }
+    return table;
+}();
+
+// Every derived property of a profile fits the reply tail
+static_assert(DERIVED_PROPERTY_COUNT * (DERIVED_NAME_MAX + PROP_VALUE_MAX) <= PROPERTY_TAIL_MAX);
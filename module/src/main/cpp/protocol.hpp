@@ -0,0 +1,211 @@
+#pragma once
+
+#include <sys/system_properties.h>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+
+#include "common.hpp"
+
+// -----------------------------------------------------------
+// Device configuration structure
+//
+// Every value ends up in a system property or a GL string, and each field is
+// bounded by PROP_VALUE_MAX and stored inline. The record is trivially copyable: the
+// companion keeps it in its snapshot and writes it to the socket as is, and
+// the app reads it straight into place without allocating.
+// -----------------------------------------------------------
+struct DeviceConfig {
+    using Field = char[PROP_VALUE_MAX];
+
+    Field brand;
+    Field device;
+    Field manufacturer;
+    Field model;
+    Field fingerprint;
+    Field product;
+
+    // Additional properties for comprehensive spoofing
+    Field board;
+    Field hardware;
+    Field serial;
+
+    // Returned by the glGetString hook, never set as properties
+    Field glRenderer;
+    Field glVendor;
+
+    bool isEmpty() const {
+        return !brand[0] && !device[0] && !manufacturer[0] &&
+               !model[0] && !fingerprint[0] && !product[0];
+    }
+
+    void clear() {
+        memset(this, 0, sizeof(*this));
+    }
+
+    // Guarantees every field is NUL-terminated after a raw copy
+    void terminate() {
+        forEachField(*this, [](Field &field) { field[PROP_VALUE_MAX - 1] = '\0'; });
+    }
+
+    // Copies value into field; values that do not fit a property are rejected
+    static bool assign(Field &field, std::string_view value) {
+        if (value.size() >= PROP_VALUE_MAX) return false;
+        memcpy(field, value.data(), value.size());
+        field[value.size()] = '\0';
+        return true;
+    }
+
+    // Visits every field in declaration order
+    template <class Self, class Fn>
+    static void forEachField(Self &config, Fn &&fn) {
+        fn(config.brand);
+        fn(config.device);
+        fn(config.manufacturer);
+        fn(config.model);
+        fn(config.fingerprint);
+        fn(config.product);
+        fn(config.board);
+        fn(config.hardware);
+        fn(config.serial);
+        fn(config.glRenderer);
+        fn(config.glVendor);
+    }
+};
+
+static_assert(std::is_trivially_copyable_v<DeviceConfig>);
+
+// -----------------------------------------------------------
+// Android uid arithmetic, mirrors android.os.UserHandle
+// -----------------------------------------------------------
+static constexpr int32_t AID_USER_OFFSET = 100000;
+static constexpr uint32_t AID_APP_START = 10000;
+static constexpr uint32_t AID_APP_END = 19999;
+static constexpr uint32_t ANY_USER = UINT32_MAX;
+
+struct AppKey {
+    uint32_t userId;
+    uint32_t appId;
+
+    static AppKey fromUid(int32_t uid) {
+        return {static_cast<uint32_t>(uid / AID_USER_OFFSET),
+                static_cast<uint32_t>(uid % AID_USER_OFFSET)};
+    }
+
+    // Only regular installed apps can be targeted; isolated and SDK sandbox
+    // processes have their own app id ranges
+    bool isApplication() const {
+        return appId >= AID_APP_START && appId <= AID_APP_END;
+    }
+
+    uint64_t packed() const {
+        return (static_cast<uint64_t>(userId) << 32) | appId;
+    }
+};
+
+// -----------------------------------------------------------
+// Companion protocol
+//
+// app -> companion: LookupRequest
+// companion -> app: int32_t LookupStatus with LOOKUP_FLAG_* bits, followed
+//                   for LOOKUP_TARGETED by the raw ProfileRecord, its
+//                   propertyBytes of property assignments and its socBytes
+//                   of SoC file entries
+// app -> companion: LaunchReport, once the app is done specializing,
+//                   followed by logBytes of deferred debug log records
+// -----------------------------------------------------------
+enum LookupStatus : int32_t {
+    LOOKUP_UNTARGETED = 0,
+    LOOKUP_TARGETED = 1,
+};
+
+// Bits or'ed into the status word, outside LOOKUP_STATUS_MASK
+static constexpr int32_t LOOKUP_STATUS_MASK = 0xffff;
+static constexpr int32_t LOOKUP_FLAG_TRACE = 1 << 16;  // Write trace markers, see trace.hpp
+
+// Longest package name, in bytes
+static constexpr uint32_t PACKAGE_NAME_MAX = 256;
+
+// Room for the process name in a request, NUL included. The main process of
+// any package fits; longer auxiliary process names are never matched.
+static constexpr uint32_t PROCESS_NAME_MAX = PACKAGE_NAME_MAX + 1;
+
+// Keyed on the uid zygote is about to switch to: the companion derives
+// (userId, appId) from it, so the app never has to parse its data dir.
+// The process name picks which processes of the package are spoofed.
+struct LookupRequest {
+    int32_t uid;
+    uint32_t processLength;            // Modified UTF-8 bytes; 0 if nice_name is null
+    char process[PROCESS_NAME_MAX];    // Only filled if processLength fits
+};
+
+// Property assignments follow the record as NUL-terminated name and value
+// pairs, in name order, and never exceed PROPERTY_TAIL_MAX bytes
+static constexpr uint32_t PROPERTY_TAIL_MAX = 8192;
+
+// SoC file entries follow the properties the same way, see SocFileCache:
+// SOC_CPUINFO_ENTRY is the "Hardware" line of /proc/cpuinfo, any other name
+// a file under SOC_SYSFS_DIR
+static constexpr uint32_t SOC_TAIL_MAX = 1024;
+static constexpr uint32_t SOC_NAME_MAX = 48;  // NUL included
+#define SOC_CPUINFO_ENTRY "cpuinfo"
+#define SOC_SYSFS_DIR "/sys/devices/soc0/"
+
+struct ProfileRecord {
+    DeviceConfig config;     // Build fields
+    uint32_t propertyCount;
+    uint32_t propertyBytes;
+    uint32_t socCount;
+    uint32_t socBytes;
+};
+
+// A targeted reply and everything after it go out in a single write
+struct LookupReply {
+    int32_t status;
+    ProfileRecord profile;
+};
+
+// -----------------------------------------------------------
+// Launch spans
+//
+// The app times its phases into a fixed record and sends it back on the
+// same connection at the end of specialization, the companion adds its
+// own phases. Nothing is written to logcat on the way.
+// -----------------------------------------------------------
+enum LaunchPhase : uint32_t {
+    // App side
+    PHASE_RESOLVE_UID,   // args -> (userId, appId)
+    PHASE_CONNECT,       // connectCompanion
+    PHASE_EXCHANGE,      // request out, status and profile back
+    PHASE_BUILD_FIELDS,  // BuildFieldManager::updateAllFields
+    PHASE_PROPERTIES,    // PropertySpoofManager::applyProperties
+    PHASE_SPECIALIZE,    // preAppSpecialize
+
+    // Companion side
+    PHASE_SNAPSHOT,      // SnapshotCache::acquire, recompiles included
+    PHASE_LOOKUP,        // ConfigSnapshot::find; the built-in index on the app side
+
+    PHASE_COUNT,
+};
+
+// Used by copgstat and as trace marker names
+static constexpr const char *PHASE_NAMES[PHASE_COUNT] = {
+    "resolve_uid", "connect", "exchange", "build_fields",
+    "properties", "specialize", "snapshot", "lookup",
+};
+
+struct LaunchReport {
+    uint32_t spanNs[PHASE_COUNT];
+
+    // Deferred debug log records following the report, see binlog.hpp
+    uint32_t logBytes;
+    uint32_t logDropped;
+
+    // Spans are clamped to ~4.3s, far beyond anything worth telling apart
+    void record(LaunchPhase phase, uint64_t startNs) {
+        uint64_t elapsed = monotonicNs() - startNs;
+        spanNs[phase] = elapsed > UINT32_MAX ? UINT32_MAX : static_cast<uint32_t>(elapsed);
+    }
+};
+
+static_assert(std::is_trivially_copyable_v<LaunchReport>);
@@ -0,0 +1,174 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "common.hpp"
+#include "protocol.hpp"
+
+#define STATS_PATH MODULE_DIR "/stats.bin"
+
+// -----------------------------------------------------------
+// Log-linear buckets, HDR style
+//
+// Values below SUB_BUCKETS are counted exactly. Above that every power of
+// two is split into SUB_BUCKETS linear sub-buckets, so a recorded
+// nanosecond value is off by at most 1/16 across the whole uint32 range.
+// -----------------------------------------------------------
+class LogLinearBuckets {
+public:
+    static constexpr uint32_t SUB_BUCKET_BITS = 4;
+    static constexpr uint32_t SUB_BUCKETS = 1u << SUB_BUCKET_BITS;
+    static constexpr uint32_t COUNT = (32 - SUB_BUCKET_BITS + 1) * SUB_BUCKETS;
+
+    static constexpr uint32_t indexOf(uint32_t value) {
+        if (value < SUB_BUCKETS) return value;
+        uint32_t exponent = 31 - __builtin_clz(value);
+        uint32_t shift = exponent - SUB_BUCKET_BITS;
+        return (exponent - SUB_BUCKET_BITS + 1) * SUB_BUCKETS + ((value >> shift) & (SUB_BUCKETS - 1));
+    }
+
+    static constexpr uint64_t lowerBound(uint32_t index) {
+        if (index < SUB_BUCKETS) return index;
+        uint32_t exponent = index / SUB_BUCKETS + SUB_BUCKET_BITS - 1;
+        uint32_t shift = exponent - SUB_BUCKET_BITS;
+        return (static_cast<uint64_t>(SUB_BUCKETS | (index % SUB_BUCKETS))) << shift;
+    }
+
+    // Exclusive
+    static constexpr uint64_t upperBound(uint32_t index) {
+        return index + 1 < COUNT ? lowerBound(index + 1) : (1ull << 32);
+    }
+};
+
+static_assert(LogLinearBuckets::indexOf(UINT32_MAX) == LogLinearBuckets::COUNT - 1);
+static_assert(LogLinearBuckets::lowerBound(LogLinearBuckets::indexOf(1000)) <= 1000);
+static_assert(LogLinearBuckets::upperBound(LogLinearBuckets::indexOf(1000)) > 1000);
+
+// -----------------------------------------------------------
+// Stats file
+//
+// Written by the companion, read by copgstat. Host byte order, since it
+// never leaves the device:
+//
+//   StatsHeader
+//   seriesCount x (StatsSeries, nonZero x StatsBucket)
+//   packageCount x StatsPackage
+//
+// There is one series per (phase, outcome). Only non-empty buckets are
+// stored.
+// -----------------------------------------------------------
+enum StatsOutcome : uint32_t {
+    OUTCOME_UNTARGETED,
+    OUTCOME_TARGETED,
+    OUTCOME_COUNT,
+};
+
+static constexpr const char *OUTCOME_NAMES[OUTCOME_COUNT] = {"untargeted", "targeted"};
+
+static constexpr char STATS_MAGIC[8] = {'C', 'O', 'P', 'G', 'S', 'T', 'A', 'T'};
+static constexpr uint32_t STATS_VERSION = 1;
+
+struct StatsHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t bucketCount;
+    uint32_t seriesCount;
+    uint32_t packageCount;
+    uint64_t launches;
+    uint64_t timeouts;         // Lookups answered but never reported back
+    uint64_t droppedPackages;  // Keys that did not fit the package table
+    uint64_t writtenAt;        // CLOCK_REALTIME seconds
+};
+
+struct StatsSeries {
+    uint32_t phase;
+    uint32_t outcome;
+    uint32_t nonZero;
+    uint32_t reserved;
+    uint64_t count;
+    uint64_t sumNs;
+};
+
+struct StatsBucket {
+    uint32_t index;
+    uint32_t reserved;
+    uint64_t count;
+};
+
+struct StatsPackage {
+    uint32_t userId;
+    uint32_t appId;
+    uint64_t hits;
+    uint64_t misses;
+    uint64_t timeouts;
+};
+
+// Decoded form, for copgstat and the tests
+struct StatsSnapshot {
+    struct Series {
+        StatsSeries info;
+        std::vector<StatsBucket> buckets;
+
+        // Upper bound of the bucket holding the given percentile, in ns
+        uint64_t percentile(double p) const {
+            if (!info.count) return 0;
+            auto rank = static_cast<uint64_t>(p / 100.0 * static_cast<double>(info.count) + 0.999999);
+            if (rank < 1) rank = 1;
+            uint64_t seen = 0;
+            for (const auto &bucket : buckets) {
+                seen += bucket.count;
+                if (seen >= rank) return LogLinearBuckets::upperBound(bucket.index) - 1;
+            }
+            return LogLinearBuckets::upperBound(buckets.back().index) - 1;
+        }
+    };
+
+    StatsHeader header{};
+    std::vector<Series> series;
+    std::vector<StatsPackage> packages;
+
+    bool parse(const uint8_t *data, size_t size) {
+        size_t offset = 0;
+        auto take = [&](void *out, size_t length) {
+            if (size - offset < length) return false;
+            memcpy(out, data + offset, length);
+            offset += length;
+            return true;
+        };
+
+        if (!take(&header, sizeof(header)) ||
+            memcmp(header.magic, STATS_MAGIC, sizeof(STATS_MAGIC)) != 0 ||
+            header.version != STATS_VERSION || header.bucketCount != LogLinearBuckets::COUNT) {
+            return false;
+        }
+
+        series.resize(header.seriesCount);
+        for (auto &entry : series) {
+            if (!take(&entry.info, sizeof(entry.info)) || entry.info.nonZero > LogLinearBuckets::COUNT) {
+                return false;
+            }
+            entry.buckets.resize(entry.info.nonZero);
+            if (!take(entry.buckets.data(), entry.buckets.size() * sizeof(StatsBucket))) return false;
+        }
+
+        if (header.packageCount > (size - offset) / sizeof(StatsPackage)) return false;
+        packages.resize(header.packageCount);
+        return take(packages.data(), packages.size() * sizeof(StatsPackage));
+    }
+
+    const Series *find(LaunchPhase phase, StatsOutcome outcome) const {
+        for (const auto &entry : series) {
+            if (entry.info.phase == phase && entry.info.outcome == outcome) return &entry;
+        }
+        return nullptr;
+    }
+
+    const StatsPackage *findPackage(AppKey key) const {
+        for (const auto &package : packages) {
+            if (package.userId == key.userId && package.appId == key.appId) return &package;
+        }
+        return nullptr;
+    }
+};
@@ -0,0 +1,87 @@
+#pragma once
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <cstdio>
+
+#include "common.hpp"
+
+#ifndef TRACE_MARKER_PATH
+#define TRACE_MARKER_PATH "/sys/kernel/tracing/trace_marker"
+#define TRACE_MARKER_LEGACY_PATH "/sys/kernel/debug/tracing/trace_marker"
+#endif
+
+// Touching this file turns the markers on, removing it turns them off
+#define TRACE_FLAG_PATH MODULE_DIR "/trace"
+
+// -----------------------------------------------------------
+// atrace-compatible trace markers
+//
+// "B|pid|name" and "E|pid" written to ftrace's trace_marker become slices
+// on the writing thread in a Perfetto system trace, right next to the
+// zygote fork and bindApplication. Each marker is a single write, so
+// concurrent writers never interleave.
+// -----------------------------------------------------------
+class TraceMarker {
+public:
+    TraceMarker() = default;
+    TraceMarker(const TraceMarker &) = delete;
+    TraceMarker &operator=(const TraceMarker &) = delete;
+    ~TraceMarker() { close(); }
+
+    bool open() {
+        if (fd >= 0) return true;
+        fd = ::open(TRACE_MARKER_PATH, O_WRONLY | O_APPEND | O_CLOEXEC);
+#ifdef TRACE_MARKER_LEGACY_PATH
+        if (fd < 0) fd = ::open(TRACE_MARKER_LEGACY_PATH, O_WRONLY | O_APPEND | O_CLOEXEC);
+#endif
+        pid = getpid();
+        return fd >= 0;
+    }
+
+    void close() {
+        if (fd >= 0) ::close(fd);
+        fd = -1;
+    }
+
+    bool enabled() const { return fd >= 0; }
+    int descriptor() const { return fd; }
+
+    // True when a begin marker was written and an end marker is owed
+    bool begin(const char *name) {
+        if (fd < 0) return false;
+        char marker[128];
+        emit(marker, snprintf(marker, sizeof(marker), "B|%d|copg.%s\n", pid, name));
+        return true;
+    }
+
+    void end() {
+        if (fd < 0) return;
+        char marker[32];
+        emit(marker, snprintf(marker, sizeof(marker), "E|%d\n", pid));
+    }
+
+private:
+    int fd = -1;
+    pid_t pid = 0;
+
+    template <size_t N>
+    void emit(const char (&marker)[N], int length) {
+        if (length <= 0) return;
+        size_t size = static_cast<size_t>(length) < N ? static_cast<size_t>(length) : N - 1;
+        // A lost marker is not worth failing a launch over
+        [[maybe_unused]] ssize_t written = write(fd, marker, size);
+    }
+};
+
+class ScopedTrace {
+public:
+    ScopedTrace(TraceMarker &marker, const char *name) : marker(marker), open(marker.begin(name)) {}
+    ~ScopedTrace() {
+        if (open) marker.end();
+    }
+
+private:
+    TraceMarker &marker;
+    bool open;
+};
@@ -62,27 +62,48 @@ mv "$TMPDIR/sepolicy.rule" "$MODPATH"
 HAS32BIT=false && ([ $(getprop ro.product.cpu.abilist32) ] || [ $(getprop ro.system.product.cpu.abilist32) ]) && HAS32BIT=true
 
 mkdir "$MODPATH/zygisk"
+mkdir "$MODPATH/companion"
+
+# extract_abi <abi>: app-side module into zygisk/, companion library into companion/
+extract_abi() {
+  extract "$ZIPFILE" "lib/$1/lib$SONAME.so" "$MODPATH/zygisk" true
+  mv "$MODPATH/zygisk/lib$SONAME.so" "$MODPATH/zygisk/$1.so"
+  extract "$ZIPFILE" "lib/$1/lib${SONAME}_companion.so" "$MODPATH/companion" true
+  mv "$MODPATH/companion/lib${SONAME}_companion.so" "$MODPATH/companion/$1.so"
+}
+
+# extract_tools <abi>: shell tools of the primary ABI into bin/; they are
+# optional, so one missing from the zip is skipped, but one present must verify
+extract_tools() {
+  unzip -l "$ZIPFILE" "lib/$1/lib${SONAME}stat.so" 2>/dev/null | grep -q "lib${SONAME}stat.so" || return 0
+  mkdir -p "$MODPATH/bin"
+  extract "$ZIPFILE" "lib/$1/lib${SONAME}stat.so" "$MODPATH/bin" true
+  mv "$MODPATH/bin/lib${SONAME}stat.so" "$MODPATH/bin/copgstat"
+}
 
 if [ "$ARCH" = "x86" ] || [ "$ARCH" = "x64" ]; then
   if [ "$HAS32BIT" = true ]; then
     ui_print "- Extracting x86 libraries"
-    extract "$ZIPFILE" "lib/x86/lib$SONAME.so" "$MODPATH/zygisk/" true
-    mv "$MODPATH/zygisk/lib$SONAME.so" "$MODPATH/zygisk/x86.so"
+    extract_abi x86
   fi
 
   ui_print "- Extracting x64 libraries"
-  extract "$ZIPFILE" "lib/x86_64/lib$SONAME.so" "$MODPATH/zygisk" true
-  mv "$MODPATH/zygisk/lib$SONAME.so" "$MODPATH/zygisk/x86_64.so"
+  extract_abi x86_64
+  extract_tools x86_64
 else
   if [ "$HAS32BIT" = true ]; then
-    extract "$ZIPFILE" "lib/armeabi-v7a/lib$SONAME.so" "$MODPATH/zygisk" true
-    mv "$MODPATH/zygisk/lib$SONAME.so" "$MODPATH/zygisk/armeabi-v7a.so"
+    extract_abi armeabi-v7a
   fi
 
   ui_print "- Extracting arm64 libraries"
-  extract "$ZIPFILE" "lib/arm64-v8a/lib$SONAME.so" "$MODPATH/zygisk" true
-  mv "$MODPATH/zygisk/lib$SONAME.so" "$MODPATH/zygisk/arm64-v8a.so"
+  extract_abi arm64-v8a
+  extract_tools arm64-v8a
 fi
 
 ui_print "- Setting permissions"
 set_perm_recursive "$MODPATH" 0 0 0755 0644
+if [ -f "$MODPATH/bin/copgstat" ]; then
+  set_perm "$MODPATH/bin/copgstat" 0 0 0755
+else
+  ui_print "! bin/copgstat is missing, launch stats will not be available from the shell"
+fi
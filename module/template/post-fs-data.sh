@@ -1 +1,8 @@
 MODDIR=${0%/*}
+
+# Without a user configuration the app-side module targets apps from the
+# profiles built into it and never contacts the companion (see builtin.hpp);
+# a configuration added later is picked up after a reboot
+if [ ! -f "$MODDIR/config.json" ] && [ -z "$(ls "$MODDIR/config.d" 2>/dev/null)" ]; then
+  resetprop copg.config builtin
+fi